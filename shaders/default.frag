@@ -1,19 +1,71 @@
 #version 460 core
+#extension GL_ARB_bindless_texture : enable
 out vec4 FragColor;
 
 in vec3 FragPos;
 in float DistanceToCamera;
 in vec3 Normal;
+in vec2 texCoord;
+flat in uint material;
 
 uniform vec3 camPos;
 uniform float time;
 uniform float bunnySoftness;
 uniform float geometryEffectStrength;
 
+// Mirrors MaterialRecord in MaterialTable.hpp: bindless handles, 0 without a texture,
+// or layers of materialArrays[array], -1 without one.
+struct MaterialRecord {
+    uvec2 diffuseHandle;
+    uvec2 specularHandle;
+    int diffuseLayer;
+    int specularLayer;
+    uint diffuseArray;
+    uint specularArray;
+};
+layout(std430, binding = 9) readonly buffer MaterialBuffer {
+    MaterialRecord materials[];
+};
+// 0: untextured, 1: bindless handles, 2: texture arrays, 3: texture_diffuse0 as bound
+// by Mesh::bindTextures.
+uniform int materialMode;
+layout(binding = 16) uniform sampler2DArray materialArrays[8];
+uniform sampler2D texture_diffuse0;
+
 float saturate(float v) {
     return clamp(v, 0.0, 1.0);
 }
 
+// Constant indices only: the array is the same across a draw but not across the program.
+vec4 sampleMaterialArray(uint array, vec3 uvw) {
+    switch (array) {
+    case 0u: return texture(materialArrays[0], uvw);
+    case 1u: return texture(materialArrays[1], uvw);
+    case 2u: return texture(materialArrays[2], uvw);
+    case 3u: return texture(materialArrays[3], uvw);
+    case 4u: return texture(materialArrays[4], uvw);
+    case 5u: return texture(materialArrays[5], uvw);
+    case 6u: return texture(materialArrays[6], uvw);
+    default: return texture(materialArrays[7], uvw);
+    }
+}
+
+// White when the material has no diffuse texture, so untextured meshes keep their look.
+vec4 materialDiffuse(vec2 uv) {
+#ifdef GL_ARB_bindless_texture
+    if (materialMode == 1 && materials[material].diffuseHandle != uvec2(0)) {
+        return texture(sampler2D(materials[material].diffuseHandle), uv);
+    }
+#endif
+    if (materialMode == 2 && materials[material].diffuseLayer >= 0) {
+        return sampleMaterialArray(materials[material].diffuseArray, vec3(uv, float(materials[material].diffuseLayer)));
+    }
+    if (materialMode == 3) {
+        return texture(texture_diffuse0, uv);
+    }
+    return vec4(1.0);
+}
+
 void main() {
     float softness = saturate(bunnySoftness);
 
@@ -30,7 +82,7 @@ void main() {
 
     float fluffVariation = 1.0;
 
-    vec3 base = mix(vec3(0.78, 0.84, 0.92), vec3(0.92, 0.96, 1.0), softness) * fluffVariation;
+    vec3 base = mix(vec3(0.78, 0.84, 0.92), vec3(0.92, 0.96, 1.0), softness) * fluffVariation * materialDiffuse(texCoord).rgb;
     vec3 ambient = mix(vec3(0.10, 0.13, 0.16), vec3(0.30, 0.36, 0.44), softness) * (0.55 + 0.45 * hemi);
     vec3 diffuse = base * ndl * mix(0.45, 0.85, softness);
     vec3 subsurface = vec3(0.78, 0.86, 0.98) * backScatter * mix(0.05, 0.22, softness);
@@ -1,6 +1,8 @@
 #version 460 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// Float meshes feed vec3 position/normal; quantized ones feed unorm16 positions and
+// octahedral normals (see PackedVertex.hpp).
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec4 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
 uniform mat4 view;
@@ -8,6 +10,24 @@ uniform mat4 projection;
 uniform mat4 model;
 uniform vec3 camPos;
 uniform float time;
+uniform bool quantizedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Batched models (DrawBatch) draw with glMultiDrawElementsIndirect; each command's
+// baseInstance indexes this buffer instead of the uniforms above.
+struct DrawData {
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint materialIndex;
+};
+layout(std430, binding = 8) readonly buffer DrawDataBuffer {
+    DrawData drawData[];
+};
+uniform bool indirectDraw;
+// MaterialTable index of a non-batched draw; batched draws take it from DrawData.
+uniform int drawMaterial;
 
 out VS_OUT {
     vec3 FragPos;
@@ -16,16 +36,39 @@ out VS_OUT {
     vec3 color;
     vec2 texCoord;
 } vs_out;
+flat out uint vsMaterial;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
 
 void main(){
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
+    mat4 modelMatrix = model;
+    vec3 offset = positionOffset;
+    vec3 scale = positionScale;
+    uint material = uint(drawMaterial);
+    if (indirectDraw) {
+        modelMatrix = drawData[gl_BaseInstance].model;
+        offset = drawData[gl_BaseInstance].positionOffset.xyz;
+        scale = drawData[gl_BaseInstance].positionScale.xyz;
+        material = drawData[gl_BaseInstance].materialIndex;
+    }
+    vsMaterial = material;
+    vec3 position = quantizedVertices ? offset + aPos.xyz * scale : aPos.xyz;
+    vec3 normal = quantizedVertices ? decodeOctahedral(aNormal.xy) : aNormal.xyz;
+
+    vs_out.FragPos = vec3(modelMatrix * vec4(position, 1.0));
     vs_out.DistanceToCamera = length(camPos - vs_out.FragPos);
     
-    vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
+    vs_out.Normal = mat3(transpose(inverse(modelMatrix))) * normal;
     
     vs_out.texCoord = aTexCoord;
     
     vs_out.color = vec3(1.0, 1.0, 1.0);
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * modelMatrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -525,7 +525,14 @@ float phaseHG(float g, float cosT) {
     return (1.0 - g2) / max(4.0 * PI * denom, 1e-6);
 }
 
-float sampleCloudDensity(vec3 worldPos) {
+// Mip level whose texels span one march step of footprint metres, for a noise volume
+// repeating frequency times per metre. Implicit derivatives are unusable inside the
+// march loop, and sampling finer than the step only costs bandwidth.
+float noiseLod(sampler3D volume, float frequency, float footprint) {
+    return max(0.0, log2(footprint * frequency * float(textureSize(volume, 0).x)));
+}
+
+float sampleCloudDensity(vec3 worldPos, float footprint) {
     float hf = heightFraction(worldPos);
     if (hf <= 0.0 || hf >= 1.0) {
         return 0.0;
@@ -542,7 +549,7 @@ float sampleCloudDensity(vec3 worldPos) {
     vec2 curl = texture(CurlNoiseTexture, fract(p.xz * 0.05 + vec2(Time * 0.01, -Time * 0.013))).rg * 2.0 - 1.0;
     p.xz += curl * mix(0.18, 0.42, softness);
 
-    vec4 lf = texture(lowFrequencyTexture, fract(p * 0.25 + vec3(Time * 0.01, 0.0, 0.0)));
+    vec4 lf = textureLod(lowFrequencyTexture, fract(p * 0.25 + vec3(Time * 0.01, 0.0, 0.0)), noiseLod(lowFrequencyTexture, 0.25 / 8000.0, footprint));
     float base = lf.r;
     float worleyFBM = saturate(lf.g * 0.625 + lf.b * 0.25 + lf.a * 0.125);
 
@@ -563,7 +570,7 @@ float sampleCloudDensity(vec3 worldPos) {
 
     shape = saturate((shape - (1.0 - coverage)) / max(coverage, 1e-4));
 
-    float hfNoise = texture(highFrequencyTexture, fract(p * 0.9 + vec3(0.0, Time * 0.02, 0.0))).r;
+    float hfNoise = textureLod(highFrequencyTexture, fract(p * 0.9 + vec3(0.0, Time * 0.02, 0.0)), noiseLod(highFrequencyTexture, 0.9 / 8000.0, footprint)).r;
     float erosion = mix(0.30, 0.14, softness);
     shape -= (1.0 - hfNoise) * erosion;
 
@@ -629,7 +636,7 @@ void marchClouds(vec3 ro, vec3 rd, vec3 sunDir, vec3 moonDir, out vec3 cloudColo
     for (int i = 0; i < steps; ++i) {
         float tStep = t0 + (float(i) + 0.5) * stepSize;
         vec3 p = ro + rd * tStep;
-        float dens = sampleCloudDensity(p);
+        float dens = sampleCloudDensity(p, stepSize);
         if (dens <= 0.0004) {
             continue;
         }
@@ -639,7 +646,7 @@ void marchClouds(vec3 ro, vec3 rd, vec3 sunDir, vec3 moonDir, out vec3 cloudColo
         float lightStep = mix(700.0, 460.0, storminess);
         for (int k = 0; k < 4; ++k) {
             lp += lightDir * lightStep;
-            shadow += sampleCloudDensity(lp);
+            shadow += sampleCloudDensity(lp, lightStep);
         }
 
         float lightTrans = exp(-shadow * mix(1.10, 1.65, storminess));
@@ -17,9 +17,11 @@ struct LBVHNode {
     float aabbMaxX, aabbMaxY, aabbMaxZ;
 };
 
+// mortonCode is (low word, high word) of a 64-bit key; 30-bit codes keep y = 0.
 struct MortonCodeElement {
-    uint mortonCode;
+    uvec2 mortonCode;
     uint elementIdx;
+    uint padding;
 };
 
 struct LBVHConstructionInfo {
@@ -0,0 +1,434 @@
+#include "BlockCompressor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr int kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Appends fields least significant bit first, the order BC7 blocks are read in.
+    class BitWriter {
+    public:
+        explicit BitWriter(unsigned char* out) : out(out) {
+            std::memset(out, 0, 16);
+        }
+
+        void write(uint32_t value, int bits) {
+            for (int i = 0; i < bits; ++i, ++position) {
+                if (value & (1u << i)) {
+                    out[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+                }
+            }
+        }
+
+    private:
+        unsigned char* out;
+        int position = 0;
+    };
+
+    void loadPixels(const unsigned char* block, float pixels[16][4]) {
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                pixels[i][c] = block[i * 4 + c];
+            }
+        }
+    }
+
+    // Endpoints at the extremes of the pixels' projection on their principal axis, found
+    // by power iteration on the covariance of the first channels channels.
+    void fitPrincipalEndpoints(const float pixels[16][4], int channels, float low[4], float high[4]) {
+        float mean[4] = {};
+        float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+        float maximum[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < channels; ++c) {
+                mean[c] += pixels[i][c] / 16.0f;
+                minimum[c] = std::min(minimum[c], pixels[i][c]);
+                maximum[c] = std::max(maximum[c], pixels[i][c]);
+            }
+        }
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int a = 0; a < channels; ++a) {
+                for (int b = 0; b < channels; ++b) {
+                    covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+                }
+            }
+        }
+
+        // The bounding box diagonal starts close to the axis for most blocks.
+        float axis[4] = {};
+        for (int c = 0; c < channels; ++c) {
+            axis[c] = maximum[c] - minimum[c];
+        }
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = {};
+            float length = 0.0f;
+            for (int a = 0; a < channels; ++a) {
+                for (int b = 0; b < channels; ++b) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length += next[a] * next[a];
+            }
+            if (length < 1e-12f) {
+                break;
+            }
+            length = std::sqrt(length);
+            for (int c = 0; c < channels; ++c) {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float lowest = 0.0f;
+        float highest = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; ++c) {
+                t += (pixels[i][c] - mean[c]) * axis[c];
+            }
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        for (int c = 0; c < 4; ++c) {
+            low[c] = c < channels ? std::clamp(mean[c] + lowest * axis[c], 0.0f, 255.0f) : 0.0f;
+            high[c] = c < channels ? std::clamp(mean[c] + highest * axis[c], 0.0f, 255.0f) : 0.0f;
+        }
+    }
+
+    // Least-squares endpoints for fixed indices: pixel i is weights[i] of first and the
+    // rest of second. Returns false when the weights cannot separate the two endpoints.
+    bool refitEndpoints(const float pixels[16][4], const float weights[16], int channels, float first[4], float second[4]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            const float a = weights[i];
+            const float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < channels; ++c) {
+                ax[c] += a * pixels[i][c];
+                bx[c] += b * pixels[i][c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) {
+            return false;
+        }
+        for (int c = 0; c < channels; ++c) {
+            first[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+            second[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    uint16_t packRGB565(const float color[4]) {
+        const uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+        const uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+        const uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRGB565(uint16_t packed, float color[4]) {
+        const uint32_t r = (packed >> 11) & 31;
+        const uint32_t g = (packed >> 5) & 63;
+        const uint32_t b = packed & 31;
+        color[0] = static_cast<float>((r << 3) | (r >> 2));
+        color[1] = static_cast<float>((g << 2) | (g >> 4));
+        color[2] = static_cast<float>((b << 3) | (b >> 2));
+        color[3] = 255.0f;
+    }
+
+    // Four-colour BC1 indices: 0 and 1 are the endpoints, 2 and 3 the thirds between.
+    float fitBC1Indices(const float pixels[16][4], uint16_t color0, uint16_t color1, uint8_t indices[16]) {
+        float palette[4][4];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float best = 1e30f;
+            for (uint8_t p = 0; p < 4; ++p) {
+                float distance = 0.0f;
+                for (int c = 0; c < 3; ++c) {
+                    const float d = pixels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < best) {
+                    best = distance;
+                    indices[i] = p;
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+
+    struct BC7Endpoint {
+        uint8_t value[4] = {}; // 7 bits per channel
+        uint8_t pBit = 0;
+
+        int channel(int c) const { return (value[c] << 1) | pBit; }
+    };
+
+    BC7Endpoint quantizeBC7(const float color[4], uint8_t pBit) {
+        BC7Endpoint endpoint;
+        endpoint.pBit = pBit;
+        for (int c = 0; c < 4; ++c) {
+            endpoint.value[c] = static_cast<uint8_t>(std::clamp<long>(std::lround((color[c] - pBit) / 2.0f), 0, 127));
+        }
+        return endpoint;
+    }
+
+    float fitBC7Indices(const float pixels[16][4], const BC7Endpoint& first, const BC7Endpoint& second, uint8_t indices[16]) {
+        float palette[16][4];
+        for (int p = 0; p < 16; ++p) {
+            for (int c = 0; c < 4; ++c) {
+                palette[p][c] = static_cast<float>(((64 - kBC7Weights[p]) * first.channel(c) + kBC7Weights[p] * second.channel(c) + 32) >> 6);
+            }
+        }
+
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float best = 1e30f;
+            for (uint8_t p = 0; p < 16; ++p) {
+                float distance = 0.0f;
+                for (int c = 0; c < 4; ++c) {
+                    const float d = pixels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < best) {
+                    best = distance;
+                    indices[i] = p;
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+}
+
+size_t BlockCompressor::blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t BlockCompressor::imageBytes(BlockFormat format, int width, int height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+BlockFormat BlockCompressor::chooseFormat(const unsigned char* rgba, size_t pixelCount, int sourceChannels) {
+    if (sourceChannels == 2) {
+        return BlockFormat::BC5;
+    }
+    if (sourceChannels == 4) {
+        for (size_t i = 0; i < pixelCount; ++i) {
+            if (rgba[i * 4 + 3] != 255) {
+                return BlockFormat::BC3;
+            }
+        }
+    }
+    return BlockFormat::BC1;
+}
+
+void BlockCompressor::encodeBC1(const unsigned char* block, unsigned char* out) {
+    float pixels[16][4];
+    loadPixels(block, pixels);
+
+    float low[4], high[4];
+    fitPrincipalEndpoints(pixels, 3, low, high);
+    uint16_t color0 = packRGB565(high);
+    uint16_t color1 = packRGB565(low);
+    uint8_t indices[16];
+    float error = fitBC1Indices(pixels, color0, color1, indices);
+
+    static constexpr float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float weights[16];
+    for (int i = 0; i < 16; ++i) {
+        weights[i] = kWeights[indices[i]];
+    }
+    float first[4] = {}, second[4] = {};
+    if (refitEndpoints(pixels, weights, 3, first, second)) {
+        const uint16_t refit0 = packRGB565(first);
+        const uint16_t refit1 = packRGB565(second);
+        uint8_t refitIndices[16];
+        const float refitError = fitBC1Indices(pixels, refit0, refit1, refitIndices);
+        if (refitError < error) {
+            color0 = refit0;
+            color1 = refit1;
+            std::memcpy(indices, refitIndices, sizeof(indices));
+        }
+    }
+
+    // color0 > color1 selects four-colour mode; swapping mirrors the indices. Equal
+    // endpoints would select three-colour mode, where only index 0 is safe.
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        for (uint8_t& index : indices) {
+            index ^= 1;
+        }
+    }
+    else if (color0 == color1) {
+        std::memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t packedIndices = 0;
+    for (int i = 0; i < 16; ++i) {
+        packedIndices |= static_cast<uint32_t>(indices[i]) << (2 * i);
+    }
+    out[0] = static_cast<unsigned char>(color0 & 0xFF);
+    out[1] = static_cast<unsigned char>(color0 >> 8);
+    out[2] = static_cast<unsigned char>(color1 & 0xFF);
+    out[3] = static_cast<unsigned char>(color1 >> 8);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<unsigned char>(packedIndices >> (8 * i));
+    }
+}
+
+void BlockCompressor::encodeBC4(const unsigned char* block, int channel, unsigned char* out) {
+    unsigned char minimum = 255;
+    unsigned char maximum = 0;
+    for (int i = 0; i < 16; ++i) {
+        minimum = std::min(minimum, block[i * 4 + channel]);
+        maximum = std::max(maximum, block[i * 4 + channel]);
+    }
+    out[0] = maximum;
+    out[1] = minimum;
+    std::memset(out + 2, 0, 6);
+    if (maximum == minimum) {
+        return;
+    }
+
+    // maximum > minimum selects the eight-value mode: the endpoints, then six steps
+    // from maximum towards minimum.
+    float palette[8] = { static_cast<float>(maximum), static_cast<float>(minimum) };
+    for (int p = 2; p < 8; ++p) {
+        palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7.0f;
+    }
+
+    uint64_t packedIndices = 0;
+    for (int i = 0; i < 16; ++i) {
+        const float value = block[i * 4 + channel];
+        uint64_t bestIndex = 0;
+        float best = 1e30f;
+        for (int p = 0; p < 8; ++p) {
+            const float distance = std::abs(value - palette[p]);
+            if (distance < best) {
+                best = distance;
+                bestIndex = static_cast<uint64_t>(p);
+            }
+        }
+        packedIndices |= bestIndex << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<unsigned char>(packedIndices >> (8 * i));
+    }
+}
+
+void BlockCompressor::encodeBC7(const unsigned char* block, unsigned char* out) {
+    float pixels[16][4];
+    loadPixels(block, pixels);
+
+    // Each fit tries all four p-bit pairs against the whole block, since one p-bit is
+    // shared by all channels. Ties go to set p-bits: only those reach 255, so opaque
+    // blocks keep alpha exactly 255 when nothing else decides.
+    BC7Endpoint first, second;
+    uint8_t indices[16];
+    float error = 1e30f;
+    auto tryEndpoints = [&](const float low[4], const float high[4]) {
+        for (int pBits = 3; pBits >= 0; --pBits) {
+            const BC7Endpoint candidateFirst = quantizeBC7(low, static_cast<uint8_t>(pBits & 1));
+            const BC7Endpoint candidateSecond = quantizeBC7(high, static_cast<uint8_t>(pBits >> 1));
+            uint8_t candidateIndices[16];
+            const float candidateError = fitBC7Indices(pixels, candidateFirst, candidateSecond, candidateIndices);
+            if (candidateError < error) {
+                error = candidateError;
+                first = candidateFirst;
+                second = candidateSecond;
+                std::memcpy(indices, candidateIndices, sizeof(indices));
+            }
+        }
+    };
+
+    float low[4], high[4];
+    fitPrincipalEndpoints(pixels, 4, low, high);
+    tryEndpoints(low, high);
+
+    float weights[16];
+    for (int i = 0; i < 16; ++i) {
+        weights[i] = (64 - kBC7Weights[indices[i]]) / 64.0f;
+    }
+    if (refitEndpoints(pixels, weights, 4, low, high)) {
+        tryEndpoints(low, high);
+    }
+
+    // The first index is stored with its top bit implied zero.
+    if (indices[0] & 8) {
+        std::swap(first, second);
+        for (uint8_t& index : indices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    BitWriter writer(out);
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        writer.write(first.value[c], 7);
+        writer.write(second.value[c], 7);
+    }
+    writer.write(first.pBit, 1);
+    writer.write(second.pBit, 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        writer.write(indices[i], 4);
+    }
+}
+
+std::vector<unsigned char> BlockCompressor::encode(BlockFormat format, const unsigned char* rgba, int width, int height, ThreadPool& pool) {
+    if (width <= 0 || height <= 0 || format == BlockFormat::Auto) {
+        return {};
+    }
+
+    const size_t blocksX = static_cast<size_t>(width + 3) / 4;
+    const size_t blocksY = static_cast<size_t>(height + 3) / 4;
+    const size_t stride = blockBytes(format);
+    std::vector<unsigned char> encoded(blocksX * blocksY * stride);
+
+    pool.parallelFor(0, blocksY, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; ++by) {
+            for (size_t bx = 0; bx < blocksX; ++bx) {
+                for (int y = 0; y < 4; ++y) {
+                    const size_t row = std::min<size_t>(by * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x) {
+                        const size_t column = std::min<size_t>(bx * 4 + x, width - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, rgba + (row * width + column) * 4, 4);
+                    }
+                }
+
+                unsigned char* out = encoded.data() + (by * blocksX + bx) * stride;
+                switch (format) {
+                case BlockFormat::BC1:
+                    encodeBC1(block, out);
+                    break;
+                case BlockFormat::BC3:
+                    encodeBC4(block, 3, out);
+                    encodeBC1(block, out + 8);
+                    break;
+                case BlockFormat::BC5:
+                    encodeBC4(block, 0, out);
+                    encodeBC4(block, 1, out + 8);
+                    break;
+                default:
+                    encodeBC7(block, out);
+                    break;
+                }
+            }
+        }
+    }, 4);
+    return encoded;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.hpp"
+
+// GPU block-compressed formats, numbered after their BCn names. Every format stores
+// 4x4 pixel blocks; BC1 takes 8 bytes per block, the others 16.
+enum class BlockFormat : uint32_t {
+    Auto = 0,
+    BC1 = 1, // RGB
+    BC3 = 3, // RGBA: a BC4 alpha block followed by a BC1 colour block
+    BC5 = 5, // two independent channels, red and green
+    BC7 = 7, // RGBA at the best quality of the four
+};
+
+// CPU encoders for RGBA8 images. BC1 fits its endpoints along the principal axis of
+// the block's colours and refits them by least squares; BC4 channels (in BC3 and BC5)
+// use the block's min and max; BC7 uses mode 6, one subset with 7-bit endpoints plus
+// p-bits and 16 interpolation steps, fitted like BC1 in four dimensions.
+namespace BlockCompressor {
+    size_t blockBytes(BlockFormat format);
+    size_t imageBytes(BlockFormat format, int width, int height);
+
+    // BC1 for opaque images, BC3 when any pixel is translucent and BC5 for
+    // two-channel sources, whose value and alpha the caller moves into red and green.
+    BlockFormat chooseFormat(const unsigned char* rgba, size_t pixelCount, int sourceChannels);
+
+    // rgba is width x height tightly packed RGBA8. Partial blocks at the right and
+    // bottom edges repeat the last column and row. Block rows are spread over the pool.
+    std::vector<unsigned char> encode(BlockFormat format, const unsigned char* rgba, int width, int height, ThreadPool& pool = globalThreadPool());
+
+    // block is 16 RGBA8 pixels in row order.
+    void encodeBC1(const unsigned char* block, unsigned char* out);
+    void encodeBC4(const unsigned char* block, int channel, unsigned char* out);
+    void encodeBC7(const unsigned char* block, unsigned char* out);
+}
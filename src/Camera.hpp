@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "Shader.hpp"
+#include "Frustum.hpp"
 
 enum Camera_Movement {
 	FORWARD,
@@ -51,6 +52,11 @@ public:
 	glm::mat4 cameraMatrix = glm::mat4(1.0f);
 	void Matrix(Shader& shader, const char* uniform);
 
+	// World-space frustum of the last view-projection passed in; call once per frame
+	// after the projection is known.
+	void updateFrustum(const glm::mat4& viewProjection) { frustum = Frustum::fromMatrix(viewProjection); }
+	const Frustum& getFrustum() const { return frustum; }
+
 	virtual void ProcessMouseScroll(float yoffset);
 	virtual void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 	virtual void invertPitch();
@@ -84,5 +90,7 @@ public:
 	float Yaw, Pitch;
 
 private:
+	Frustum frustum;
+
 	virtual void updateCameraVectors();
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "CompressedTexture.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include "MeshCache.hpp"
+#include "stb_image.hpp"
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    constexpr char kMagic[8] = { 'E', 'D', 'T', 'E', 'X', 'B', 'C', 'N' };
+    constexpr uint64_t kLevelAlignment = 16;
+
+    struct TextureHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t format;
+        uint32_t sourceChannels;
+        uint32_t flags;
+        uint32_t levelCount;
+        uint32_t padding;
+        uint64_t sourceSize;
+        int64_t sourceModifiedTime;
+        uint64_t sourceHash;
+        uint64_t fileSize;
+    };
+
+    struct LevelRecord {
+        uint32_t width, height, depth, padding;
+        uint64_t offset, size;
+    };
+
+    uint64_t alignLevel(uint64_t offset) {
+        return (offset + kLevelAlignment - 1) & ~(kLevelAlignment - 1);
+    }
+
+    bool isBlockFormat(uint32_t format) {
+        return format == 1 || format == 3 || format == 5 || format == 7;
+    }
+}
+
+std::string CompressedTexture::pathFor(const std::string& sourcePath) {
+    return sourcePath + ".ctex";
+}
+
+uint32_t CompressedTexture::flagsFor(const ImportOptions& options) {
+    uint32_t flags = options.flipVertically ? kFlagFlipped : 0;
+    if (options.volumeAtlas) {
+        flags |= kFlagVolume;
+    }
+    if (options.mipmaps) {
+        flags |= kFlagMipmaps;
+        if (options.mipFilter == MipFilter::Kaiser) {
+            flags |= kFlagKaiser;
+        }
+    }
+    if (options.srgb) {
+        flags |= kFlagSRGB;
+    }
+    return flags;
+}
+
+bool CompressedTexture::import(const std::string& sourcePath, const ImportOptions& options) {
+    int width = 0, height = 0, channels = 0;
+    stbi_set_flip_vertically_on_load_thread(options.flipVertically);
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels(stbi_load(sourcePath.c_str(), &width, &height, &channels, 4), stbi_image_free);
+    if (!pixels) {
+        MyglobalLogger().logMessage(Logger::WARNING, "Cannot decode " + sourcePath + " for block compression", __FILE__, __LINE__);
+        return false;
+    }
+
+    int depth = 1;
+    const uint32_t flags = flagsFor(options);
+    BlockFormat format = options.format;
+    if (options.volumeAtlas) {
+        if (static_cast<long long>(height) != 1LL * width * width) {
+            MyglobalLogger().logMessage(Logger::WARNING, sourcePath + " is not a width x width^2 volume atlas", __FILE__, __LINE__);
+            return false;
+        }
+        depth = width;
+        height = width;
+        format = BlockFormat::BC7;
+    }
+
+    const size_t pixelCount = static_cast<size_t>(width) * height * depth;
+    if (format == BlockFormat::Auto) {
+        format = BlockCompressor::chooseFormat(pixels.get(), pixelCount, channels);
+    }
+    // Filtered before the BC5 channel move below, so alpha is never treated as colour.
+    std::vector<MipLevel> mips;
+    if (flags & kFlagMipmaps) {
+        mips = MipGenerator::build(pixels.get(), width, height, depth, 4, { options.mipFilter, options.srgb });
+    }
+
+    // Slices are encoded one by one: a volume's block rows must not straddle two slices.
+    std::vector<std::vector<unsigned char>> encoded;
+    std::vector<CompressedLevel> levels;
+    for (size_t i = 0; i <= mips.size(); ++i) {
+        unsigned char* rgba = i == 0 ? pixels.get() : mips[i - 1].pixels.data();
+        const int levelWidth = i == 0 ? width : mips[i - 1].width;
+        const int levelHeight = i == 0 ? height : mips[i - 1].height;
+        const int levelDepth = i == 0 ? depth : mips[i - 1].depth;
+        const size_t sliceBytes = static_cast<size_t>(levelWidth) * levelHeight * 4;
+        if (format == BlockFormat::BC5 && channels == 2) {
+            for (size_t p = 0; p < sliceBytes * levelDepth / 4; ++p) {
+                rgba[p * 4 + 1] = rgba[p * 4 + 3];
+            }
+        }
+
+        std::vector<unsigned char> blocks;
+        for (int z = 0; z < levelDepth; ++z) {
+            std::vector<unsigned char> slice = BlockCompressor::encode(format, rgba + z * sliceBytes, levelWidth, levelHeight);
+            blocks.insert(blocks.end(), slice.begin(), slice.end());
+        }
+        encoded.push_back(std::move(blocks));
+        levels.push_back({ static_cast<uint32_t>(levelWidth), static_cast<uint32_t>(levelHeight), static_cast<uint32_t>(levelDepth), {} });
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].blocks = encoded[i];
+    }
+
+    return write(sourcePath, format, static_cast<uint32_t>(channels), flags, levels);
+}
+
+bool CompressedTexture::write(const std::string& sourcePath, BlockFormat format, uint32_t sourceChannels, uint32_t flags, const std::vector<CompressedLevel>& levels) {
+    MeshCacheSourceKey key;
+    if (!MeshCache::describeSource(sourcePath, key, true)) {
+        MyglobalLogger().logMessage(Logger::WARNING, "Cannot describe " + sourcePath + " for the texture cache", __FILE__, __LINE__);
+        return false;
+    }
+
+    TextureHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.format = static_cast<uint32_t>(format);
+    header.sourceChannels = sourceChannels;
+    header.flags = flags;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.sourceSize = key.size;
+    header.sourceModifiedTime = key.modifiedTime;
+    header.sourceHash = key.contentHash;
+
+    std::vector<LevelRecord> records(levels.size());
+    uint64_t offset = alignLevel(sizeof(TextureHeader) + records.size() * sizeof(LevelRecord));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        records[i] = { levels[i].width, levels[i].height, levels[i].depth, 0, offset, levels[i].blocks.size() };
+        offset = alignLevel(offset + levels[i].blocks.size());
+    }
+    header.fileSize = offset;
+
+    // Written under a temporary name and renamed, so a reader never maps a partial file.
+    const std::string cachePath = pathFor(sourcePath);
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Cannot write texture cache " + tempPath, __FILE__, __LINE__);
+            return false;
+        }
+
+        static const char zeros[kLevelAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(LevelRecord)));
+        uint64_t position = sizeof(header) + records.size() * sizeof(LevelRecord);
+        for (size_t i = 0; i < levels.size(); ++i) {
+            out.write(zeros, static_cast<std::streamsize>(records[i].offset - position));
+            out.write(reinterpret_cast<const char*>(levels[i].blocks.data()), static_cast<std::streamsize>(levels[i].blocks.size()));
+            position = records[i].offset + levels[i].blocks.size();
+        }
+        out.write(zeros, static_cast<std::streamsize>(header.fileSize - position));
+
+        if (!out) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Failed while writing texture cache " + tempPath, __FILE__, __LINE__);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        MyglobalLogger().logMessage(Logger::WARNING, "Cannot replace texture cache " + cachePath, __FILE__, __LINE__);
+        return false;
+    }
+
+    MyglobalLogger().logMessage(Logger::INFO, "Wrote texture cache " + cachePath + " (BC" + std::to_string(header.format) + ", " +
+        std::to_string(levels.size()) + " levels, " + std::to_string(header.fileSize) + " bytes)", __FILE__, __LINE__);
+    return true;
+}
+
+bool CompressedTexture::open(const std::string& sourcePath) {
+    levels.clear();
+    format = BlockFormat::Auto;
+    sourceChannels = 0;
+    flags = 0;
+    file.close();
+
+    const std::string cachePath = pathFor(sourcePath);
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error)) {
+        return false;
+    }
+
+    MeshCacheSourceKey key;
+    if (!MeshCache::describeSource(sourcePath, key, false) || !file.open(cachePath)) {
+        return false;
+    }
+
+    TextureHeader header;
+    const std::span<const unsigned char> bytes = file.bytes();
+    if (bytes.size() < sizeof(header)) {
+        file.close();
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        !isBlockFormat(header.format) || header.fileSize != bytes.size() ||
+        header.levelCount == 0 || header.levelCount > (bytes.size() - sizeof(header)) / sizeof(LevelRecord)) {
+        MyglobalLogger().logMessage(Logger::INFO, "Texture cache " + cachePath + " has an incompatible format", __FILE__, __LINE__);
+        file.close();
+        return false;
+    }
+
+    bool sourceMatches = header.sourceSize == key.size && header.sourceModifiedTime == key.modifiedTime;
+    if (!sourceMatches && header.sourceSize == key.size) {
+        MeshCache::describeSource(sourcePath, key, true);
+        sourceMatches = header.sourceHash == key.contentHash;
+    }
+    if (!sourceMatches) {
+        MyglobalLogger().logMessage(Logger::INFO, "Texture cache " + cachePath + " is stale", __FILE__, __LINE__);
+        file.close();
+        return false;
+    }
+
+    const BlockFormat storedFormat = static_cast<BlockFormat>(header.format);
+    std::vector<LevelRecord> records(header.levelCount);
+    std::memcpy(records.data(), bytes.data() + sizeof(header), records.size() * sizeof(LevelRecord));
+    for (const LevelRecord& record : records) {
+        const uint64_t expected = static_cast<uint64_t>(BlockCompressor::imageBytes(storedFormat, record.width, record.height)) * record.depth;
+        if (record.width == 0 || record.height == 0 || record.depth == 0 || record.size != expected ||
+            record.offset > bytes.size() || record.size > bytes.size() - record.offset) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Texture cache " + cachePath + " is corrupt", __FILE__, __LINE__);
+            levels.clear();
+            file.close();
+            return false;
+        }
+        levels.push_back({ record.width, record.height, record.depth, bytes.subspan(record.offset, record.size) });
+    }
+
+    format = storedFormat;
+    sourceChannels = header.sourceChannels;
+    flags = header.flags;
+    return true;
+}
+
+bool CompressedTexture::openOrImport(const std::string& sourcePath, const ImportOptions& options) {
+    if (open(sourcePath) && flags == flagsFor(options) &&
+        (options.volumeAtlas || options.format == BlockFormat::Auto || options.format == format)) {
+        return true;
+    }
+    // The mapping must be released before the cache file is replaced.
+    file.close();
+    levels.clear();
+    return import(sourcePath, options) && open(sourcePath);
+}
+
+size_t CompressedTexture::getByteSize() const {
+    size_t bytes = 0;
+    for (const CompressedLevel& level : levels) {
+        bytes += level.blocks.size();
+    }
+    return bytes;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "BlockCompressor.hpp"
+#include "MappedFile.hpp"
+#include "MipGenerator.hpp"
+
+// One mip level. Volumes store depth 2D block images back to back, the layout
+// glCompressedTexImage3D expects.
+struct CompressedLevel {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t depth = 1;
+    std::span<const unsigned char> blocks;
+};
+
+// Block-compressed copy of an image file with its mip chain, stored as <source>.ctex
+// and validated against the source like MeshCache. The name keeps the source's
+// extension because texture folders often hold one stem in several formats. Levels
+// are handed out as spans into the read-only mapping.
+class CompressedTexture {
+public:
+    static constexpr uint32_t kVersion = 2;
+    // Header flags, recorded so a cache imported with other options is re-imported.
+    static constexpr uint32_t kFlagFlipped = 1u << 0;
+    static constexpr uint32_t kFlagVolume = 1u << 1;
+    static constexpr uint32_t kFlagMipmaps = 1u << 2;
+    static constexpr uint32_t kFlagSRGB = 1u << 3;
+    static constexpr uint32_t kFlagKaiser = 1u << 4;
+
+    struct ImportOptions {
+        // Auto picks per image with BlockCompressor::chooseFormat.
+        BlockFormat format = BlockFormat::Auto;
+        // Rows bottom-up, as Texture::TextureFromFile loads them.
+        bool flipVertically = true;
+        // A width x width*width image holding width slices of a cube, the cloud noise
+        // atlas layout. Always BC7, the only format here GL accepts for 3D textures;
+        // mode 6 shares one line across all channels, so unsuited to independent ones.
+        bool volumeAtlas = false;
+        // Built on the CPU by MipGenerator, volumes included.
+        bool mipmaps = true;
+        MipFilter mipFilter = MipFilter::Box;
+        // Colour is sRGB-encoded and mips are averaged in linear light; off for data.
+        bool srgb = false;
+    };
+
+    static std::string pathFor(const std::string& sourcePath);
+    static uint32_t flagsFor(const ImportOptions& options);
+    // Decodes sourcePath, encodes every level and writes the cache.
+    static bool import(const std::string& sourcePath, const ImportOptions& options);
+    static bool write(const std::string& sourcePath, BlockFormat format, uint32_t sourceChannels, uint32_t flags, const std::vector<CompressedLevel>& levels);
+
+    // Maps the cache next to sourcePath; false when it is missing, stale or corrupt.
+    bool open(const std::string& sourcePath);
+    // open, importing first when the cache is unusable or was built with other options.
+    bool openOrImport(const std::string& sourcePath, const ImportOptions& options);
+
+    BlockFormat getFormat() const { return format; }
+    // Two-channel sources hold value and alpha in red and green and sample through a swizzle.
+    uint32_t getSourceChannels() const { return sourceChannels; }
+    uint32_t getFlags() const { return flags; }
+    const std::vector<CompressedLevel>& getLevels() const { return levels; }
+    size_t getByteSize() const;
+
+private:
+    MappedFile file;
+    BlockFormat format = BlockFormat::Auto;
+    uint32_t sourceChannels = 0;
+    uint32_t flags = 0;
+    std::vector<CompressedLevel> levels;
+};
@@ -0,0 +1,138 @@
+#include "DrawBatch.hpp"
+#include "../src/Logger/Logger.hpp"
+
+void DrawBatch::build(std::vector<Mesh>& meshes, const MaterialTable& materials) {
+    if (meshes.empty()) {
+        return;
+    }
+    format = meshes[0].vertexFormat;
+    for (const Mesh& mesh : meshes) {
+        if (mesh.vertexFormat != format || !mesh.hasBuffers()) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Meshes cannot share one draw batch, drawing them one by one", __FILE__, __LINE__);
+            return;
+        }
+    }
+
+    size_t vertexBytes = 0;
+    size_t indexCount = 0;
+    slots.resize(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        slots[i].baseVertex = static_cast<int32_t>(vertexBytes / meshes[i].getVertexStride());
+        slots[i].firstIndex = static_cast<uint32_t>(indexCount);
+        vertexBytes += meshes[i].vertices.size() * meshes[i].getVertexStride();
+        indexCount += meshes[i].getBufferIndexCount();
+        slots[i].material = materials.getMaterialIndex(i);
+    }
+
+    vbo = std::make_unique<VBO>(nullptr, static_cast<GLsizeiptr>(vertexBytes));
+    ebo = std::make_unique<EBO>(nullptr, static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo->getID());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        glBindBuffer(GL_COPY_READ_BUFFER, meshes[i].vbo->getID());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(slots[i].baseVertex) * meshes[i].getVertexStride(),
+            static_cast<GLsizeiptr>(meshes[i].vertices.size() * meshes[i].getVertexStride()));
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo->getID());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        glBindBuffer(GL_COPY_READ_BUFFER, meshes[i].ebo->getID());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(slots[i].firstIndex) * sizeof(GLuint),
+            static_cast<GLsizeiptr>(meshes[i].getBufferIndexCount() * sizeof(GLuint)));
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    vao = std::make_unique<VAO>();
+    vao->Bind();
+    vbo->Bind();
+    ebo->Bind();
+    Mesh::linkVertexAttributes(*vao, *vbo, format);
+    vao->UnBind();
+    vbo->UnBind();
+    ebo->UnBind();
+
+    for (Mesh& mesh : meshes) {
+        mesh.releaseBuffers();
+    }
+    materialCommands.resize(materials.getMaterialCount());
+
+    MyglobalLogger().logMessage(Logger::INFO, "Draw batch: " + std::to_string(meshes.size()) + " meshes, " +
+        std::to_string(materials.getMaterialCount()) + " materials, " + std::to_string(vertexBytes / 1024) + " KiB vertices, " +
+        std::to_string(indexCount) + " indices", __FILE__, __LINE__);
+}
+
+void DrawBatch::begin() {
+    drawData.clear();
+    drawMeshes.clear();
+    for (std::vector<DrawElementsIndirectCommand>& material : materialCommands) {
+        material.clear();
+    }
+}
+
+uint32_t DrawBatch::addDraw(size_t meshIndex, const glm::mat4& world) {
+    DrawData data;
+    data.model = world;
+    data.materialIndex = slots[meshIndex].material;
+    drawData.push_back(data);
+    drawMeshes.push_back(meshIndex);
+    return static_cast<uint32_t>(drawData.size() - 1);
+}
+
+void DrawBatch::addRange(uint32_t draw, IndexRange range) {
+    if (range.count == 0) {
+        return;
+    }
+    const MeshSlot& slot = slots[drawMeshes[draw]];
+    materialCommands[slot.material].push_back({ range.count, 1, slot.firstIndex + range.firstIndex, slot.baseVertex, draw });
+}
+
+void DrawBatch::submit(Shader& shader, std::vector<Mesh>& meshes, const MaterialTable& materials) {
+    lastCommandCount = 0;
+    lastDrawCalls = 0;
+    if (!isBuilt() || drawData.empty()) {
+        return;
+    }
+
+    // Quantization is per mesh, so it travels with the draw rather than as a uniform.
+    for (size_t d = 0; d < drawData.size(); ++d) {
+        const Mesh& mesh = meshes[drawMeshes[d]];
+        drawData[d].positionOffset = glm::vec4(mesh.quantization.offset, 0.0f);
+        drawData[d].positionScale = glm::vec4(mesh.quantization.scale, 0.0f);
+    }
+    commands.clear();
+    for (const std::vector<DrawElementsIndirectCommand>& material : materialCommands) {
+        commands.insert(commands.end(), material.begin(), material.end());
+    }
+    if (commands.empty()) {
+        return;
+    }
+    drawDataBuffer.upload(drawData.data(), drawData.size() * sizeof(DrawData));
+    commandBuffer.upload(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    shader.setBool("indirectDraw", true);
+    shader.setBool("quantizedVertices", format == VertexFormat::Quantized);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawDataBinding, drawDataBuffer.getID());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.getID());
+    vao->Bind();
+
+    if (materials.getMode() != MaterialTable::Mode::Bound) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()), 0);
+        lastDrawCalls = 1;
+    }
+    else {
+        size_t commandOffset = 0;
+        for (size_t m = 0; m < materialCommands.size(); ++m) {
+            if (materialCommands[m].empty()) {
+                continue;
+            }
+            materials.bindMaterial(shader, meshes, static_cast<uint32_t>(m));
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(commandOffset * sizeof(DrawElementsIndirectCommand)),
+                static_cast<GLsizei>(materialCommands[m].size()), 0);
+            commandOffset += materialCommands[m].size();
+            lastDrawCalls++;
+        }
+    }
+
+    vao->UnBind();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    lastCommandCount = commands.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <gl/glew.h>
+#include <glm/glm.hpp>
+#include "GPUBuffer.hpp"
+#include "MaterialTable.hpp"
+#include "Mesh.hpp"
+
+// One entry of the draw-data SSBO, read by default.vert at gl_BaseInstance (std430).
+struct DrawData {
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::vec4 positionOffset = glm::vec4(0.0f);
+    glm::vec4 positionScale = glm::vec4(1.0f);
+    uint32_t materialIndex = 0;
+    uint32_t padding[3] = {};
+};
+
+// Layout fixed by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// All meshes of a model in one VBO/EBO pair, drawn with one glMultiDrawElementsIndirect
+// instead of a VAO bind, uniform updates and a draw call per mesh. Each command's
+// baseInstance selects its DrawData, so the vertex shader needs no per-draw uniforms, and
+// the DrawData's material index selects textures from the MaterialTable. Commands are
+// grouped by material; only a table in Bound mode splits the submit, binding each
+// material's textures before its group.
+class DrawBatch {
+public:
+    static constexpr GLuint kDrawDataBinding = 8;
+
+    // Copies every mesh's VBO and EBO into the shared buffers on the GPU, then releases
+    // the per-mesh buffers. All meshes must use the same vertex format. materials must be
+    // built from the same meshes.
+    void build(std::vector<Mesh>& meshes, const MaterialTable& materials);
+    bool isBuilt() const { return vao != nullptr; }
+
+    // Per frame: begin, addDraw once per visible mesh, addRange for each index range of
+    // it (a LOD level or merged meshlet runs), then submit.
+    void begin();
+    uint32_t addDraw(size_t meshIndex, const glm::mat4& world);
+    void addRange(uint32_t draw, IndexRange range);
+    void submit(Shader& shader, std::vector<Mesh>& meshes, const MaterialTable& materials);
+
+    size_t getMaterialCount() const { return materialCommands.size(); }
+    size_t getLastCommandCount() const { return lastCommandCount; }
+    size_t getLastDrawCalls() const { return lastDrawCalls; }
+
+private:
+    struct MeshSlot {
+        int32_t baseVertex = 0;
+        uint32_t firstIndex = 0;
+        uint32_t material = 0;
+    };
+
+    std::unique_ptr<VAO> vao;
+    std::unique_ptr<VBO> vbo;
+    std::unique_ptr<EBO> ebo;
+    VertexFormat format = VertexFormat::Float;
+    std::vector<MeshSlot> slots;
+
+    std::vector<DrawData> drawData;
+    std::vector<size_t> drawMeshes;
+    std::vector<std::vector<DrawElementsIndirectCommand>> materialCommands;
+    std::vector<DrawElementsIndirectCommand> commands;
+    GPUBuffer drawDataBuffer;
+    GPUBuffer commandBuffer;
+    size_t lastCommandCount = 0;
+    size_t lastDrawCalls = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Six planes (left, right, bottom, top, near, far) with normals pointing inwards,
+// extracted from a clip matrix (Gribb & Hartmann). A point p is inside when
+// dot(plane.xyz, p) + plane.w >= 0 for every plane. The default frustum contains
+// everything.
+struct Frustum {
+    glm::vec4 planes[6] = {
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+    };
+
+    static Frustum fromMatrix(const glm::mat4& clip) {
+        const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+        const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+        const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+        const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0;
+        frustum.planes[1] = row3 - row0;
+        frustum.planes[2] = row3 + row1;
+        frustum.planes[3] = row3 - row1;
+        frustum.planes[4] = row3 + row2;
+        frustum.planes[5] = row3 - row2;
+        for (glm::vec4& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    [[nodiscard]] bool intersectsSphere(glm::vec3 center, float radius) const {
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Box given in local space and placed by an affine world matrix. The world-space box
+    // enclosing it (Arvo) is tested, so a few boxes near frustum corners pass falsely.
+    [[nodiscard]] bool intersectsBox(const glm::mat4& world, glm::vec3 localMin, glm::vec3 localMax) const {
+        const glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+        const glm::vec3 localExtent = (localMax - localMin) * 0.5f;
+        const glm::vec3 center = glm::vec3(world * glm::vec4(localCenter, 1.0f));
+        const glm::vec3 extent = glm::abs(glm::vec3(world[0])) * localExtent.x +
+            glm::abs(glm::vec3(world[1])) * localExtent.y + glm::abs(glm::vec3(world[2])) * localExtent.z;
+        for (const glm::vec4& plane : planes) {
+            const glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,88 @@
+#include "GPUBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+GPUBuffer::~GPUBuffer() {
+    release();
+}
+
+bool GPUBuffer::reserve(size_t bytes) {
+    if (bytes <= capacity && id != 0) {
+        return false;
+    }
+
+    const size_t newCapacity = std::max(bytes, capacity + capacity / 2);
+    release();
+
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = 0;
+        if (access == Access::Write) {
+            flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        }
+        else if (access == Access::Read) {
+            flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_CLIENT_STORAGE_BIT;
+        }
+        else {
+            flags = GL_DYNAMIC_STORAGE_BIT;
+        }
+
+        glBufferStorage(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, flags);
+        if (access != Access::DeviceOnly) {
+            mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, newCapacity, flags & ~GL_CLIENT_STORAGE_BIT);
+        }
+    }
+    else {
+        const GLenum usage = (access == Access::Write) ? GL_DYNAMIC_DRAW : (access == Access::Read ? GL_DYNAMIC_READ : GL_DYNAMIC_COPY);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, usage);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    capacity = newCapacity;
+    return true;
+}
+
+void GPUBuffer::upload(const void* data, size_t bytes, size_t offset) {
+    if (bytes == 0) {
+        return;
+    }
+    reserve(offset + bytes);
+
+    if (mapped) {
+        std::memcpy(static_cast<char*>(mapped) + offset, data, bytes);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GPUBuffer::download(void* data, size_t bytes, size_t offset) const {
+    if (bytes == 0 || offset + bytes > capacity) {
+        return;
+    }
+
+    if (mapped && access == Access::Read) {
+        std::memcpy(data, static_cast<const char*>(mapped) + offset, bytes);
+        return;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, id);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void GPUBuffer::release() {
+    if (id != 0) {
+        if (mapped) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &id);
+    }
+    id = 0;
+    capacity = 0;
+    mapped = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <gl/glew.h>
+#include <cstddef>
+
+// GL buffer for data that is rebuilt often. Storage only ever grows, so steady-state
+// rebuilds reuse one allocation instead of round-tripping the driver allocator. With
+// ARB_buffer_storage the store is immutable and Write/Read buffers stay persistently
+// mapped; otherwise it falls back to glBufferData + glBufferSubData/glGetBufferSubData.
+class GPUBuffer {
+public:
+    enum class Access {
+        DeviceOnly,
+        Write,
+        Read
+    };
+
+    GPUBuffer() = default;
+    explicit GPUBuffer(Access access) : access(access) {}
+    ~GPUBuffer();
+
+    GPUBuffer(const GPUBuffer&) = delete;
+    GPUBuffer& operator=(const GPUBuffer&) = delete;
+
+    // Grows to at least `bytes`; contents are not preserved across a reallocation.
+    // Returns true when the buffer name changed.
+    bool reserve(size_t bytes);
+    // Mapped Write buffers are written in place: the caller must not overwrite a range
+    // that commands still in flight are reading.
+    void upload(const void* data, size_t bytes, size_t offset = 0);
+    // Mapped Read buffers are only valid after the writing commands completed
+    // (GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT plus a fence or glFinish).
+    void download(void* data, size_t bytes, size_t offset = 0) const;
+    void release();
+
+    GLuint getID() const { return id; }
+    size_t getCapacity() const { return capacity; }
+    void* getMappedPointer() const { return mapped; }
+
+private:
+    GLuint id = 0;
+    size_t capacity = 0;
+    void* mapped = nullptr;
+    Access access = Access::DeviceOnly;
+};
@@ -1,5 +1,9 @@
 ﻿#include "Init.hpp"
 #include "Menu.hpp"
+#include "CompressedTexture.hpp"
+#include "TextureCache.hpp"
+#include "TextureStreamer.hpp"
+#include "ThreadPool.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -67,6 +71,7 @@ Init::Init() : Window() {
     );
     menu = std::make_unique<Menu>();
     bvh = std::make_unique<BVH>();
+    sceneBVH = std::make_unique<SceneBVH>();
     lastX = getWindowWidth() / 2.0f;
     lastY = getWindowHeight() / 2.0f;
     firstClick = true;
@@ -75,6 +80,10 @@ Init::Init() : Window() {
 
 Init::~Init() {
     destroyEnvironmentResources();
+    // The model's material table drops its texture handles before the cache deletes the textures.
+    model.reset();
+    globalTextureStreamer().release();
+    globalTextureCache().release();
 }
 
 std::filesystem::path Init::resolveResourcePath(const std::string& relativePath) {
@@ -113,7 +122,14 @@ std::filesystem::path Init::resolveResourcePath(const std::string& relativePath)
     return direct;
 }
 
-GLuint Init::loadTexture2DForAtmosphere(const std::filesystem::path& path) {
+GLuint Init::loadTexture2DForAtmosphere(const std::filesystem::path& path, bool compress) {
+    CompressedTexture compressed;
+    if (compress && compressed.openOrImport(path.string(), { .format = BlockFormat::BC7, .flipVertically = false })) {
+        if (const GLuint textureId = Texture::TextureFromCompressed(compressed)) {
+            return textureId;
+        }
+    }
+
     stbi_set_flip_vertically_on_load(false);
 
     int width = 0;
@@ -132,8 +148,7 @@ GLuint Init::loadTexture2DForAtmosphere(const std::filesystem::path& path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    Texture::uploadWithMips(GL_TEXTURE_2D, GL_RGBA8, GL_RGBA, data, width, height, 1, 4);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     stbi_image_free(data);
@@ -141,6 +156,8 @@ GLuint Init::loadTexture2DForAtmosphere(const std::filesystem::path& path) {
 }
 
 GLuint Init::loadTexture3DFromAtlas(const std::filesystem::path& path) {
+    // Uncompressed: the atlas channels are independent noise octaves, and the BC7 encoder
+    // (mode 6) fits all four onto one line per block.
     stbi_set_flip_vertically_on_load(false);
 
     int width = 0;
@@ -171,9 +188,9 @@ GLuint Init::loadTexture3DFromAtlas(const std::filesystem::path& path) {
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, width, width, width, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    Texture::uploadWithMips(GL_TEXTURE_3D, GL_RGBA8, GL_RGBA, data, width, width, width, 4);
     glBindTexture(GL_TEXTURE_3D, 0);
 
     stbi_image_free(data);
@@ -209,8 +226,10 @@ bool Init::initializeEnvironmentResources() {
 
     lowFrequencyTex3D = loadTexture3DFromAtlas(resolveResourcePath("../../../textures/LowFrequency3DTexture.tga"));
     highFrequencyTex3D = loadTexture3DFromAtlas(resolveResourcePath("../../../textures/HighFrequency3DTexture.tga"));
-    weatherTex2D = loadTexture2DForAtmosphere(resolveResourcePath("../../../textures/weathermap.png"));
-    curlNoiseTex2D = loadTexture2DForAtmosphere(resolveResourcePath("../../../textures/curlNoise.png"));
+    // Weather and curl channels are independent data, which mode-6 BC7 would force onto
+    // one line per block; they stay uncompressed like the noise volumes.
+    weatherTex2D = loadTexture2DForAtmosphere(resolveResourcePath("../../../textures/weathermap.png"), false);
+    curlNoiseTex2D = loadTexture2DForAtmosphere(resolveResourcePath("../../../textures/curlNoise.png"), false);
 
     auto loadOptionalTexture2D = [this](const std::vector<std::string>& candidates, const std::array<unsigned char, 4>& fallbackColor, bool& loadedFromFile, const std::string& label) -> GLuint {
         loadedFromFile = false;
@@ -409,19 +428,35 @@ void Init::initialize() {
     normalsShader = std::make_unique<Shader>("../../../shaders/default.vert", "../../../shaders/normals.frag", "../../../shaders/normals.geom");
     aabbShader = std::make_unique<Shader>("../../../shaders/aabb.vert", "../../../shaders/aabb.frag");
 
-    mortonShader = std::make_unique<Shader>("../../../shaders/lbvh_morton_codes.comp");
-    sortShader = std::make_unique<Shader>("../../../shaders/lbvh_single_radixsort.comp");
-    hierarchyShader = std::make_unique<Shader>("../../../shaders/lbvh_hierarchy.comp");
-    lbvhAABBShader = std::make_unique<Shader>("../../../shaders/lbvh_bounding_boxes.comp");
+    if (GLEW_VERSION_4_3) {
+        try {
+            mortonShader = std::make_unique<Shader>("../../../shaders/lbvh_morton_codes.comp");
+            sortHistogramShader = std::make_unique<Shader>("../../../shaders/lbvh_radixsort_histogram.comp");
+            sortScanShader = std::make_unique<Shader>("../../../shaders/lbvh_radixsort_scan.comp");
+            sortScatterShader = std::make_unique<Shader>("../../../shaders/lbvh_radixsort_scatter.comp");
+            hierarchyShader = std::make_unique<Shader>("../../../shaders/lbvh_hierarchy.comp");
+            lbvhAABBShader = std::make_unique<Shader>("../../../shaders/lbvh_bounding_boxes.comp");
+        }
+        catch (const std::exception& e) {
+            MyglobalLogger().logMessage(Logger::WARNING, "LBVH compute shaders unavailable, using CPU builder: " + std::string(e.what()), __FILE__, __LINE__);
+        }
+    }
+    gpuLBVHAvailable = mortonShader && sortHistogramShader && sortScanShader && sortScatterShader && hierarchyShader && lbvhAABBShader;
+    if (!gpuLBVHAvailable) {
+        menu->useCPULBVH = true;
+    }
 
-    if (!shader || !textRender || !normalsShader || !aabbShader || !mortonShader || !sortShader || !hierarchyShader || !lbvhAABBShader) {
+    if (!shader || !textRender || !normalsShader || !aabbShader) {
         MyglobalLogger().logMessage(Logger::ERROR, "Failed to load shaders!", __FILE__, __LINE__);
         return;
     }
 
     GLint success;
     GLchar infoLog[512];
-    for (const auto& s : { shader.get(), textRender.get(), normalsShader.get(), aabbShader.get(), mortonShader.get(), sortShader.get(), hierarchyShader.get(), lbvhAABBShader.get() }) {
+    for (const auto& s : { shader.get(), textRender.get(), normalsShader.get(), aabbShader.get(), mortonShader.get(), sortHistogramShader.get(), sortScanShader.get(), sortScatterShader.get(), hierarchyShader.get(), lbvhAABBShader.get() }) {
+        if (!s) {
+            continue;
+        }
         glGetProgramiv(s->ID, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(s->ID, 512, NULL, infoLog);
@@ -433,44 +468,32 @@ void Init::initialize() {
     MyglobalLogger().logMessage(Logger::INFO, "OpenGL Version: " + std::string(reinterpret_cast<const char*>(glGetString(GL_VERSION))), __FILE__, __LINE__);
 
     try {
-        model = std::make_unique<Model>("../../../models/bunny/scene.gltf");
+        model = std::make_unique<Model>("../../../models/bunny/scene.gltf", modelLoadOptions);
         MyglobalLogger().logMessage(Logger::INFO, "Successfully loaded GLTF model: scene.gltf", __FILE__, __LINE__);
 
-        glm::vec3 overallMin(FLT_MAX);
-        glm::vec3 overallMax(-FLT_MAX);
-        std::vector<glm::vec3> positions;
-        std::vector<uint32_t> indices;
-        const auto& meshLocalMatrices = model->getMeshLocalMatrices();
-
         if (model && !model->meshes.empty()) {
-            for (size_t i = 0; i < model->meshes.size(); ++i) {
-                const auto& mesh = model->meshes[i];
-                if (!mesh.vertices.empty()) {
-                    const glm::mat4 meshLocal = (i < meshLocalMatrices.size()) ? meshLocalMatrices[i] : glm::mat4(1.0f);
-                    const uint32_t vertexOffset = static_cast<uint32_t>(positions.size());
-                    for (const auto& vertex : mesh.vertices) {
-                        const glm::vec3 modelSpacePos = glm::vec3(meshLocal * glm::vec4(vertex.position, 1.0f));
-                        positions.push_back(modelSpacePos);
-                        overallMin = glm::min(overallMin, modelSpacePos);
-                        overallMax = glm::max(overallMax, modelSpacePos);
-                    }
-                    for (const auto& index : mesh.indices) {
-                        indices.push_back(vertexOffset + index);
-                    }
-                }
+            gatherLBVHGeometry();
+
+            glm::vec3 overallMin(FLT_MAX);
+            glm::vec3 overallMax(-FLT_MAX);
+            for (const auto& pos : lbvhObjectPositions) {
+                overallMin = glm::min(overallMin, pos);
+                overallMax = glm::max(overallMax, pos);
             }
             menu->setModelBounds(overallMin, overallMax);
 
-            glm::mat4 initialModelMatrix = menu->getModelMatrix();
-            std::vector<glm::vec3> transformedPositions;
-            transformedPositions.reserve(positions.size());
-            for (const auto& pos : positions) {
-                transformedPositions.push_back(glm::vec3(initialModelMatrix * glm::vec4(pos, 1.0f)));
+            sceneBVH->buildBLAS(model->meshes, model->getCachedMeshBVHs());
+            if (!model->isFromCache()) {
+                std::vector<std::span<const LBVHNode>> meshBVHs;
+                for (const auto& meshBVH : sceneBVH->blas) {
+                    meshBVHs.push_back(meshBVH->m_bvh);
+                }
+                model->saveCache(meshBVHs);
             }
+            sceneBVH->updateInstances(model->getMeshLocalMatrices(), menu->getModelMatrix());
 
-            double startTime = glfwGetTime();
-            bvh->buildLBVHDynamic(transformedPositions, indices, mortonShader.get(), sortShader.get(), hierarchyShader.get(), lbvhAABBShader.get());
-            menu->lastLBVHBuildTime = (glfwGetTime() - startTime) * 1000.0f;
+            buildLBVH(menu->getModelMatrix());
+            lbvhVisualizationDirty = false;
         }
     }
     catch (const std::exception& e) {
@@ -539,6 +562,53 @@ void Init::initialize() {
         });
 }
 
+void Init::gatherLBVHGeometry() {
+    lbvhObjectPositions.clear();
+    lbvhIndices.clear();
+    const auto& meshLocalMatrices = model->getMeshLocalMatrices();
+
+    for (size_t i = 0; i < model->meshes.size(); ++i) {
+        const auto& mesh = model->meshes[i];
+        const glm::mat4 meshLocal = (i < meshLocalMatrices.size()) ? meshLocalMatrices[i] : glm::mat4(1.0f);
+        const uint32_t vertexOffset = static_cast<uint32_t>(lbvhObjectPositions.size());
+        for (const auto& vertex : mesh.vertices) {
+            lbvhObjectPositions.push_back(glm::vec3(meshLocal * glm::vec4(vertex.position, 1.0f)));
+        }
+        for (const auto& index : mesh.indices) {
+            lbvhIndices.push_back(vertexOffset + index);
+        }
+    }
+}
+
+void Init::buildLBVH(const glm::mat4& modelMatrix) {
+    double startTime = glfwGetTime();
+    bvh->buildQuality = menu->lbvhBuildQuality;
+    bvh->mortonPrecision = menu->lbvhMortonPrecision;
+    std::vector<glm::vec3> positions(lbvhObjectPositions.size());
+    globalThreadPool().parallelFor(0, positions.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            positions[i] = glm::vec3(modelMatrix * glm::vec4(lbvhObjectPositions[i], 1.0f));
+        }
+    });
+
+    if (menu->useCPULBVH || !gpuLBVHAvailable) {
+        bvh->buildLBVHParallelCPU(positions, lbvhIndices);
+    }
+    else {
+        RadixSortShaders sortShaders{ sortHistogramShader.get(), sortScanShader.get(), sortScatterShader.get() };
+        bvh->buildLBVHDynamic(positions, lbvhIndices, mortonShader.get(), sortShaders, hierarchyShader.get(), lbvhAABBShader.get());
+        if (bvh->isBuildPending()) {
+            // Timing and cost are reported once render() sees the fence signal.
+            lbvhBuildStartTime = startTime;
+            lbvhBuildMatrix = modelMatrix;
+            return;
+        }
+    }
+    menu->lastLBVHBuildTime = (glfwGetTime() - startTime) * 1000.0f;
+    menu->lastLBVHSAHCost = bvh->builtSAHCost;
+    menu->lastLBVHDuplicateRate = bvh->lastDuplicateCodeRate;
+}
+
 void Init::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && menu->isEditorModeActive()) {
         ImGuiIO& io = ImGui::GetIO();
@@ -557,42 +627,21 @@ void Init::mouseButtonCallback(GLFWwindow* window, int button, int action, int m
         glm::vec3 worldRay = glm::normalize(glm::vec3(glm::inverse(view) * eyeCoords));
         glm::vec3 rayOrigin = camera->Position;
 
-        glm::vec3 modelPos = menu->getModelPosition();
-        glm::vec3 modelScale = menu->getModelScale();
-        glm::vec3 boxMin = menu->localMinBounds * modelScale + modelPos;
-        glm::vec3 boxMax = menu->localMaxBounds * modelScale + modelPos;
-
-        if (rayAABBIntersectWorld(rayOrigin, worldRay, boxMin, boxMax)) {
-            menu->setModelSelected(true);
-        }
-        else {
-            glm::vec3 expandedMin = boxMin - glm::vec3(2.0f);
-            glm::vec3 expandedMax = boxMax + glm::vec3(2.0f);
-            if (rayAABBIntersectWorld(rayOrigin, worldRay, expandedMin, expandedMax)) {
-                menu->setModelSelected(true);
-            }
-            else {
-                menu->setModelSelected(false);
-            }
+        double pickStart = glfwGetTime();
+        RayHit hit;
+        bool picked = sceneBVH && sceneBVH->intersect(rayOrigin, worldRay, hit);
+        menu->setModelSelected(picked);
+
+        if (picked) {
+            MyglobalLogger().logMessage(Logger::DEBUG,
+                "Picked mesh " + std::to_string(hit.meshIndex) + " triangle " + std::to_string(hit.triangleIndex) +
+                " at distance " + std::to_string(hit.distance) + " (bary " + std::to_string(hit.barycentrics.x) + ", " +
+                std::to_string(hit.barycentrics.y) + ") in " + std::to_string((glfwGetTime() - pickStart) * 1e6) + " us",
+                __FILE__, __LINE__);
         }
     }
 }
 
-bool Init::rayAABBIntersectWorld(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& boxMin, const glm::vec3& boxMax) {
-    glm::vec3 invDir;
-    invDir.x = (abs(dir.x) > 0.0001f) ? 1.0f / dir.x : 1e30f;
-    invDir.y = (abs(dir.y) > 0.0001f) ? 1.0f / dir.y : 1e30f;
-    invDir.z = (abs(dir.z) > 0.0001f) ? 1.0f / dir.z : 1e30f;
-
-    glm::vec3 t1 = (boxMin - origin) * invDir;
-    glm::vec3 t2 = (boxMax - origin) * invDir;
-    glm::vec3 tmin = glm::min(t1, t2);
-    glm::vec3 tmax = glm::max(t1, t2);
-    float t_near = glm::max(glm::max(tmin.x, tmin.y), tmin.z);
-    float t_far = glm::min(glm::min(tmax.x, tmax.y), tmax.z);
-    return t_near <= t_far && t_far >= 0.0f;
-}
-
 void Init::processInput(GLFWwindow* window) {
     static float lastFrame = 0.0f;
     float currentFrame = glfwGetTime();
@@ -668,45 +717,72 @@ void Init::render() {
 
     projection = glm::perspective(glm::radians(camera->Zoom), (float)width / (float)height, 0.1f, 200.0f);
     view = camera->getViewMatrix();
+    camera->updateFrustum(projection * view);
+    globalTextureStreamer().setFrameBudget(static_cast<size_t>(menu->textureBudgetMB) << 20);
+    globalTextureStreamer().update();
+    menu->texturesPending = static_cast<int>(globalTextureStreamer().getPendingCount());
+    menu->texturesResident = static_cast<int>(globalTextureStreamer().getResidentCount());
+    menu->textureUploadKB = static_cast<int>(globalTextureStreamer().getLastFrameBytes() >> 10);
+    globalTextureCache().setBudget(static_cast<size_t>(menu->textureCacheBudgetMB) << 20);
+    globalTextureCache().trim();
+    menu->textureCacheStats = globalTextureCache().getStats();
     const float sceneTime = static_cast<float>(glfwGetTime());
 
     // === ПРОВЕРКА ИЗМЕНЕНИЯ ТРАНСФОРМАЦИИ И ПЕРЕСЧЕТ LBVH ===
     static glm::mat4 lastModelMatrix = glm::mat4(0.0f);
     glm::mat4 currentModelMatrix = menu->getModelMatrix();
 
-    if (lastModelMatrix != currentModelMatrix || menu->rebuildLBVH) {
+    if (lastModelMatrix != currentModelMatrix) {
         if (model && !model->meshes.empty()) {
-            std::vector<glm::vec3> positions;
-            std::vector<uint32_t> indices;
-            const auto& meshLocalMatrices = model->getMeshLocalMatrices();
-
-            for (size_t i = 0; i < model->meshes.size(); ++i) {
-                const auto& mesh = model->meshes[i];
-                const glm::mat4 meshLocal = (i < meshLocalMatrices.size()) ? meshLocalMatrices[i] : glm::mat4(1.0f);
-                const uint32_t vertexOffset = static_cast<uint32_t>(positions.size());
-                for (const auto& vertex : mesh.vertices) {
-                    positions.push_back(glm::vec3(meshLocal * glm::vec4(vertex.position, 1.0f))); // Координаты в пространстве модели
-                }
-                for (const auto& index : mesh.indices) {
-                    indices.push_back(vertexOffset + index);
-                }
-            }
+            // Moving the model only touches the TLAS; the per-mesh BLAS stay as built.
+            double tlasStart = glfwGetTime();
+            sceneBVH->updateInstances(model->getMeshLocalMatrices(), currentModelMatrix);
+            menu->lastTLASBuildTime = (glfwGetTime() - tlasStart) * 1000.0f;
+            menu->tlasInstanceCount = static_cast<int>(sceneBVH->instances.size());
+            lbvhVisualizationDirty = true;
+        }
+        lastModelMatrix = currentModelMatrix;
+    }
 
-            // Применяем текущую трансформацию
-            std::vector<glm::vec3> transformedPositions;
-            transformedPositions.reserve(positions.size());
-            for (const auto& pos : positions) {
-                transformedPositions.push_back(glm::vec3(currentModelMatrix * glm::vec4(pos, 1.0f)));
+    // A GPU build in flight keeps the previous tree on screen until its fence signals.
+    if (bvh->pollGPUBuild()) {
+        menu->lastLBVHBuildTime = (glfwGetTime() - lbvhBuildStartTime) * 1000.0f;
+        menu->lastLBVHSAHCost = bvh->builtSAHCost;
+        menu->lastLBVHDuplicateRate = bvh->lastDuplicateCodeRate;
+        if (lbvhBuildMatrix != currentModelMatrix) {
+            lbvhVisualizationDirty = true;
+        }
+    }
+
+    // The flat world-space LBVH only feeds the node visualization, so it is brought up to
+    // date while it is shown or when a rebuild is requested explicitly. Requests made while
+    // a build is pending are kept and served after it lands.
+    if (!bvh->isBuildPending() && ((lbvhVisualizationDirty && menu->showLBVH) || menu->rebuildLBVH)) {
+        if (model && !model->meshes.empty()) {
+            if (lbvhIndices.empty()) {
+                gatherLBVHGeometry();
             }
 
-            double startTime = glfwGetTime();
-            bvh->buildLBVHDynamic(transformedPositions, indices, mortonShader.get(), sortShader.get(), hierarchyShader.get(), lbvhAABBShader.get());
-            menu->lastLBVHBuildTime = (glfwGetTime() - startTime) * 1000.0f;
-            menu->rebuildLBVH = false;
-            lastModelMatrix = currentModelMatrix;
+            // Gizmo drags only move the model: refit the existing tree and fall back to a
+            // full rebuild when asked to or when the refitted tree got too loose.
+            bool refitted = false;
+            if (!menu->rebuildLBVH && menu->refitLBVHOnTransform) {
+                double refitStart = glfwGetTime();
+                refitted = bvh->refit(lbvhObjectPositions, lbvhIndices, currentModelMatrix);
+                menu->lastLBVHRefitTime = (glfwGetTime() - refitStart) * 1000.0f;
+                menu->lastLBVHCostRatio = bvh->lastSAHCostRatio;
+            }
 
-            MyglobalLogger().logMessage(Logger::INFO, "LBVH rebuilt with " + std::to_string(bvh->numInternalNodes) + " nodes (transform changed)", __FILE__, __LINE__);
+            if (!refitted) {
+                buildLBVH(currentModelMatrix);
+                menu->lastLBVHCostRatio = 1.0f;
+                if (!bvh->isBuildPending()) {
+                    MyglobalLogger().logMessage(Logger::INFO, "LBVH rebuilt with " + std::to_string(bvh->numInternalNodes) + " nodes (transform changed)", __FILE__, __LINE__);
+                }
+            }
         }
+        menu->rebuildLBVH = false;
+        lbvhVisualizationDirty = false;
     }
 
     renderEnvironment(width, height, sceneTime);
@@ -782,7 +858,20 @@ void Init::render() {
             if (timeLocation != -1) {
                 shader->setFloat("time", sceneTime);
             }
+            model->setLODSelection(menu->useMeshLOD, projection[1][1] * 0.5f * static_cast<float>(height), menu->lodPixelError);
+            model->setFrustumCulling(menu->useFrustumCulling);
+            model->setMeshletCulling(menu->useMeshletCulling, menu->useConeCulling);
             model->Draw(*shader, *camera, modelMatrix);
+            menu->lodDrawnTriangles = static_cast<int>(model->getLastDrawnTriangles());
+            menu->lodFullTriangles = static_cast<int>(model->getFullTriangles());
+            menu->visibleMeshlets = static_cast<int>(model->getVisibleMeshlets());
+            menu->totalMeshlets = static_cast<int>(model->getTotalMeshlets());
+            menu->visibleMeshes = static_cast<int>(model->getVisibleMeshes());
+            menu->culledMeshes = static_cast<int>(model->getCulledMeshes());
+            menu->indirectCommands = static_cast<int>(model->getIndirectCommands());
+            menu->indirectDrawCalls = static_cast<int>(model->getIndirectDrawCalls());
+            menu->materialCount = static_cast<int>(model->getMaterials().getMaterialCount());
+            menu->materialBinding = MaterialTable::modeName(model->getMaterials().getMode());
 
             if (showNormals && normalsShader) {
                 glDisable(GL_BLEND);
@@ -806,7 +895,7 @@ void Init::render() {
                 aabbShader->setMat4("projection", projection);
 
                 glBindVertexArray(cubeVAO);
-                glBindBuffer(GL_ARRAY_BUFFER, bvh->aabbInstanceVBO);
+                glBindBuffer(GL_ARRAY_BUFFER, bvh->aabbInstanceBuffer.getID());
 
                 glEnableVertexAttribArray(1);
                 glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (void*)0);
@@ -906,7 +995,7 @@ void Init::render() {
                 if (bvh->numInternalNodes > 0) {
                     textRender->setVec3("Color", glm::vec3(1.0f, 0.0f, 1.0f));
                     std::string lbvhDebug = "LBVH Nodes: " + std::to_string(bvh->numInternalNodes) +
-                        " VBO: " + std::to_string(bvh->aabbInstanceVBO);
+                        " VBO: " + std::to_string(bvh->aabbInstanceBuffer.getID());
                     font->print(lbvhDebug.c_str(), 10.0f, 235.0f, 0.8f, glm::vec3(1.0f, 0.0f, 1.0f));
                 }
             }
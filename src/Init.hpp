@@ -19,6 +19,7 @@
 #include "Model.hpp"
 #include "Menu.hpp"
 #include "LBVH.hpp"
+#include "SceneBVH.hpp"
 
 class Init : public Window {
 public:
@@ -39,15 +40,16 @@ public:
     void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
     void processInput(GLFWwindow* window);
     void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-    bool rayAABBIntersectWorld(const glm::vec3& origin, const glm::vec3& dir,
-        const glm::vec3& boxMin, const glm::vec3& boxMax);
 
 private:
+    void gatherLBVHGeometry();
+    void buildLBVH(const glm::mat4& modelMatrix);
     bool initializeEnvironmentResources();
     void renderEnvironment(int width, int height, float timeSeconds);
     void destroyEnvironmentResources();
     static std::filesystem::path resolveResourcePath(const std::string& relativePath);
-    static GLuint loadTexture2DForAtmosphere(const std::filesystem::path& path);
+    // compress loads colour maps through a BC7 .ctex cache; data textures pass false.
+    static GLuint loadTexture2DForAtmosphere(const std::filesystem::path& path, bool compress = true);
     static GLuint loadTexture3DFromAtlas(const std::filesystem::path& path);
 private:
     std::unique_ptr<Camera> camera;
@@ -57,14 +59,27 @@ private:
     std::unique_ptr<Shader> textRender;
     std::unique_ptr<Shader> aabbShader;
     std::unique_ptr<Shader> mortonShader;
-    std::unique_ptr<Shader> sortShader;
+    std::unique_ptr<Shader> sortHistogramShader;
+    std::unique_ptr<Shader> sortScanShader;
+    std::unique_ptr<Shader> sortScatterShader;
     std::unique_ptr<Shader> hierarchyShader;
     std::unique_ptr<Shader> lbvhAABBShader;
     std::unique_ptr<Font> font;
     std::unique_ptr<Texture> texture;
     std::unique_ptr<Model> model;
+    ModelLoadOptions modelLoadOptions{
+        .optimizeMeshes = true,
+        .vertexFormat = VertexFormat::Quantized,
+        .generateLODs = true,
+        .buildMeshlets = true,
+        .batchDraws = true,
+        .streamTextures = true,
+        .compressTextures = true,
+        .hashTextureContent = true,
+    };
     std::unique_ptr<Menu> menu;
     std::unique_ptr<BVH> bvh;
+    std::unique_ptr<SceneBVH> sceneBVH;
     GLuint cubeVAO, cubeVBO, cubeEBO;
     GLuint atmosphereVAO = 0;
     GLuint atmosphereVBO = 0;
@@ -77,6 +92,12 @@ private:
     bool hasMoonTexture = false;
     bool hasStarTexture = false;
     bool atmosphereReady = false;
+    bool gpuLBVHAvailable = false;
+    std::vector<glm::vec3> lbvhObjectPositions;
+    std::vector<uint32_t> lbvhIndices;
+    bool lbvhVisualizationDirty = true;
+    double lbvhBuildStartTime = 0.0;
+    glm::mat4 lbvhBuildMatrix = glm::mat4(1.0f);
 
 private:
     glm::mat4 projection;
@@ -1,37 +1,222 @@
 #include "LBVH.hpp"
+#include "ThreadPool.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
 #include <vector>
 
-void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
-    Shader* mortonShader, Shader* sortShader, Shader* hierarchyShader, Shader* aabbShader) {
+namespace {
+    struct Element {
+        uint32_t primitiveIdx;
+        float aabbMinX, aabbMinY, aabbMinZ;
+        float aabbMaxX, aabbMaxY, aabbMaxZ;
+    };
 
-    m_bvh.clear();
-    primitives.clear();
-    mortonCodes.clear();
+    // CPU mirrors of lbvh_morton_codes.comp / lbvh_hierarchy.comp. Any change here must be
+    // made in the shaders too, otherwise the two builders stop producing the same tree.
+    uint32_t expandBits(uint32_t v) {
+        v = v & 0x000003FFu;
+        v = (v ^ (v << 16)) & 0x030000FFu;
+        v = (v ^ (v << 8)) & 0x0300F00Fu;
+        v = (v ^ (v << 4)) & 0x030C30C3u;
+        v = (v ^ (v << 2)) & 0x09249249u;
+        return v;
+    }
 
-    uint32_t numTris = indices.size() / 3;
-    if (numTris == 0) {
-        MyglobalLogger().logMessage(Logger::ERROR, "No triangles to build LBVH", __FILE__, __LINE__);
-        return;
+    uint64_t expandBits21(uint64_t v) {
+        v = v & 0x1FFFFFull;
+        v = (v ^ (v << 32)) & 0x001F00000000FFFFull;
+        v = (v ^ (v << 16)) & 0x001F0000FF0000FFull;
+        v = (v ^ (v << 8)) & 0x100F00F00F00F00Full;
+        v = (v ^ (v << 4)) & 0x10C30C30C30C30C3ull;
+        v = (v ^ (v << 2)) & 0x1249249249249249ull;
+        return v;
     }
 
-    MyglobalLogger().logMessage(Logger::INFO, "Building LBVH for " + std::to_string(numTris) + " triangles", __FILE__, __LINE__);
+    uint64_t morton3D(const glm::vec3& pos, const glm::vec3& sceneMin, const glm::vec3& sceneExtent, MortonPrecision precision) {
+        const glm::vec3 safeExtent = glm::max(sceneExtent, glm::vec3(1e-6f));
+        const glm::vec3 normalized = glm::clamp((pos - sceneMin) / safeExtent, 0.0f, 1.0f);
 
+        if (precision == MortonPrecision::Bits63) {
+            glm::uvec3 coords = glm::uvec3(normalized * 2097151.0f);
+            coords = glm::min(coords, glm::uvec3(2097151u));
+            return (expandBits21(coords.x) << 2) | (expandBits21(coords.y) << 1) | expandBits21(coords.z);
+        }
 
-    if (!glfwGetCurrentContext()) {
-        MyglobalLogger().logMessage(Logger::ERROR, "No OpenGL context available!", __FILE__, __LINE__);
-        return;
+        glm::uvec3 coords = glm::uvec3(normalized * 1023.0f);
+        coords = glm::min(coords, glm::uvec3(1023u));
+
+        return expandBits(coords.x) * 4u + expandBits(coords.y) * 2u + expandBits(coords.z);
     }
 
-    AABB globalAABB;
-    primitives.resize(numTris);
+    int delta(const MortonCodeElement* codes, int numElements, int i, int j) {
+        if (j < 0 || j >= numElements) return -1;
 
-    struct Element {
-        uint32_t primitiveIdx;
-        float aabbMinX, aabbMinY, aabbMinZ;
-        float aabbMaxX, aabbMaxY, aabbMaxZ;
-    };
-    std::vector<Element> gpuElements(numTris);
+        const uint64_t codeI = codes[i].mortonCode;
+        const uint64_t codeJ = codes[j].mortonCode;
+
+        // Codes are compared as 64-bit keys; in 30-bit mode every prefix is 32 longer,
+        // which keeps the ordering the hierarchy relies on.
+        if (codeI == codeJ) {
+            const uint32_t xorResult = codes[i].elementIdx ^ codes[j].elementIdx;
+            if (xorResult == 0) return 96;
+            return 64 + std::countl_zero(xorResult);
+        }
+
+        return std::countl_zero(codeI ^ codeJ);
+    }
+
+    void determineRange(const MortonCodeElement* codes, int numElements, int idx, int& lower, int& upper) {
+        const int deltaL = delta(codes, numElements, idx, idx - 1);
+        const int deltaR = delta(codes, numElements, idx, idx + 1);
+        const int d = (deltaR >= deltaL) ? 1 : -1;
+        const int deltaMin = std::min(deltaL, deltaR);
+
+        int lMax = 2;
+        while (delta(codes, numElements, idx, idx + lMax * d) > deltaMin) {
+            lMax = lMax << 1;
+        }
+
+        int l = 0;
+        for (int t = lMax >> 1; t > 0; t >>= 1) {
+            if (delta(codes, numElements, idx, idx + (l + t) * d) > deltaMin) {
+                l += t;
+            }
+        }
+
+        const int jdx = idx + l * d;
+        lower = std::min(idx, jdx);
+        upper = std::max(idx, jdx);
+    }
+
+    int findSplit(const MortonCodeElement* codes, int numElements, int first, int last) {
+        const int commonPrefix = delta(codes, numElements, first, last);
+        int split = first;
+        int stride = last - first;
+
+        do {
+            stride = (stride + 1) >> 1;
+            const int newSplit = split + stride;
+            if (newSplit < last) {
+                const int splitPrefix = delta(codes, numElements, first, newSplit);
+                if (splitPrefix > commonPrefix) {
+                    split = newSplit;
+                }
+            }
+        } while (stride > 1);
+
+        return split;
+    }
+
+    // Stable LSD radix sort on the low keyBits of the code, 8 bits per pass. Input arrives in
+    // elementIdx order, so stability reproduces the (mortonCode, elementIdx) ordering of the GPU path.
+    void radixSortMortonCodes(std::vector<MortonCodeElement>& codes, uint32_t keyBits, ThreadPool& pool) {
+        constexpr uint32_t kRadixBits = 8;
+        constexpr uint32_t kBuckets = 1u << kRadixBits;
+        constexpr size_t kMinChunk = 16384;
+
+        const size_t count = codes.size();
+        const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.getThreadCount(), (count + kMinChunk - 1) / kMinChunk));
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+        std::vector<MortonCodeElement> scratch(count);
+        std::vector<std::array<uint32_t, kBuckets>> histograms(chunkCount);
+
+        for (uint32_t shift = 0; shift < keyBits; shift += kRadixBits) {
+            pool.parallelFor(0, chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+                for (size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk) {
+                    auto& histogram = histograms[chunk];
+                    histogram.fill(0);
+                    const size_t end = std::min(count, (chunk + 1) * chunkSize);
+                    for (size_t i = chunk * chunkSize; i < end; ++i) {
+                        histogram[(codes[i].mortonCode >> shift) & (kBuckets - 1)]++;
+                    }
+                }
+            }, 1);
+
+            bool allInOneBucket = false;
+            uint32_t running = 0;
+            for (uint32_t digit = 0; digit < kBuckets; ++digit) {
+                const uint32_t digitStart = running;
+                for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+                    const uint32_t bucketCount = histograms[chunk][digit];
+                    histograms[chunk][digit] = running;
+                    running += bucketCount;
+                }
+                if (running - digitStart == count) {
+                    allInOneBucket = true;
+                }
+            }
+            if (allInOneBucket) {
+                continue;
+            }
+
+            pool.parallelFor(0, chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+                for (size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk) {
+                    auto offsets = histograms[chunk];
+                    const size_t end = std::min(count, (chunk + 1) * chunkSize);
+                    for (size_t i = chunk * chunkSize; i < end; ++i) {
+                        scratch[offsets[(codes[i].mortonCode >> shift) & (kBuckets - 1)]++] = codes[i];
+                    }
+                }
+            }, 1);
+
+            codes.swap(scratch);
+        }
+    }
+
+    uint32_t mortonKeyBits(MortonPrecision precision) {
+        return precision == MortonPrecision::Bits63 ? 64u : 32u;
+    }
+
+    float surfaceArea(const AABB& box) {
+        const glm::vec3 d = glm::max(box.max - box.min, glm::vec3(0.0f));
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    AABB nodeBounds(const LBVHNode& node) {
+        AABB box;
+        box.min = glm::vec3(node.aabbMinX, node.aabbMinY, node.aabbMinZ);
+        box.max = glm::vec3(node.aabbMaxX, node.aabbMaxY, node.aabbMaxZ);
+        return box;
+    }
+
+    void setNodeBounds(LBVHNode& node, const AABB& box) {
+        node.aabbMinX = box.min.x; node.aabbMinY = box.min.y; node.aabbMinZ = box.min.z;
+        node.aabbMaxX = box.max.x; node.aabbMaxY = box.max.y; node.aabbMaxZ = box.max.z;
+    }
+
+    AABB unionBounds(const AABB& a, const AABB& b) {
+        AABB box;
+        box.min = glm::min(a.min, b.min);
+        box.max = glm::max(a.max, b.max);
+        return box;
+    }
+
+    // Unit SAH costs shared by computeSAHCost, the binned builder and treelet restructuring.
+    constexpr float kTraversalCost = 1.0f;
+    constexpr float kIntersectionCost = 1.0f;
+
+    constexpr int kSAHBins = 16;
+    constexpr uint32_t kSAHParallelCutoff = 4096;
+    constexpr int kTreeletLeaves = 5;
+    constexpr int kTreeletPasses = 2;
+
+    void unionChildBounds(LBVHNode& node, const LBVHNode& a, const LBVHNode& b) {
+        node.aabbMinX = std::min(a.aabbMinX, b.aabbMinX);
+        node.aabbMinY = std::min(a.aabbMinY, b.aabbMinY);
+        node.aabbMinZ = std::min(a.aabbMinZ, b.aabbMinZ);
+        node.aabbMaxX = std::max(a.aabbMaxX, b.aabbMaxX);
+        node.aabbMaxY = std::max(a.aabbMaxY, b.aabbMaxY);
+        node.aabbMaxZ = std::max(a.aabbMaxZ, b.aabbMaxZ);
+    }
+}
+
+bool BVH::computePrimitiveBounds(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, AABB& globalAABB) {
+    const uint32_t numTris = static_cast<uint32_t>(indices.size() / 3);
+    primitives.resize(numTris);
 
     for (size_t i = 0; i < numTris; ++i) {
         uint32_t idx0 = indices[i * 3];
@@ -43,7 +228,8 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
                 "Invalid triangle indices at " + std::to_string(i) +
                 ": [" + std::to_string(idx0) + "," + std::to_string(idx1) + "," + std::to_string(idx2) +
                 "] with positions.size()=" + std::to_string(positions.size()), __FILE__, __LINE__);
-            return;
+            primitives.clear();
+            return false;
         }
 
         glm::vec3 v0 = positions[idx0];
@@ -55,15 +241,7 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
         primitives[i].aabb.expand(v0);
         primitives[i].aabb.expand(v1);
         primitives[i].aabb.expand(v2);
-        primitives[i].index = i;
-
-        gpuElements[i].primitiveIdx = i;
-        gpuElements[i].aabbMinX = primitives[i].aabb.min.x;
-        gpuElements[i].aabbMinY = primitives[i].aabb.min.y;
-        gpuElements[i].aabbMinZ = primitives[i].aabb.min.z;
-        gpuElements[i].aabbMaxX = primitives[i].aabb.max.x;
-        gpuElements[i].aabbMaxY = primitives[i].aabb.max.y;
-        gpuElements[i].aabbMaxZ = primitives[i].aabb.max.z;
+        primitives[i].index = static_cast<uint32_t>(i);
 
         globalAABB.expand(v0);
         globalAABB.expand(v1);
@@ -82,119 +260,828 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
             "Degenerate global AABB - all vertices are at the same location! Extent: (" +
             std::to_string(extent.x) + "," + std::to_string(extent.y) + "," + std::to_string(extent.z) + ")",
             __FILE__, __LINE__);
+        primitives.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void BVH::sortMortonCodesGPU(uint32_t numElements, const RadixSortShaders& sortShaders) {
+    // 4-bit LSD radix sort, eight passes per 32-bit word of the code. Every pass is a stable
+    // scatter and the morton pass writes elementIdx in order, so equal codes keep
+    // their (code, elementIdx) ordering without a CPU round trip.
+    constexpr uint32_t radixBits = 4;
+    constexpr uint32_t radixBuckets = 1u << radixBits;
+    constexpr uint32_t keysPerWorkGroup = 256 * 16;
+
+    const uint32_t sortWorkGroups = (numElements + keysPerWorkGroup - 1) / keysPerWorkGroup;
+    const uint32_t histogramEntries = sortWorkGroups * radixBuckets;
+
+    mortonScratchBuffer.reserve(numElements * sizeof(MortonCodeElement));
+    histogramBuffer.reserve(histogramEntries * sizeof(uint32_t));
+    const GLuint histogram = histogramBuffer.getID();
+
+    GLuint keysIn = mortonBuffer.getID();
+    GLuint keysOut = mortonScratchBuffer.getID();
+
+    const uint32_t keyBits = mortonKeyBits(mortonPrecision);
+    for (uint32_t shift = 0; shift < keyBits; shift += radixBits) {
+        glUseProgram(sortShaders.histogram->ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keysIn);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, histogram);
+        glUniform1ui(glGetUniformLocation(sortShaders.histogram->ID, "numElements"), numElements);
+        glUniform1ui(glGetUniformLocation(sortShaders.histogram->ID, "bitShift"), shift);
+        glDispatchCompute(sortWorkGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(sortShaders.scan->ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogram);
+        glUniform1ui(glGetUniformLocation(sortShaders.scan->ID, "numEntries"), histogramEntries);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(sortShaders.scatter->ID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keysIn);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keysOut);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, histogram);
+        glUniform1ui(glGetUniformLocation(sortShaders.scatter->ID, "numElements"), numElements);
+        glUniform1ui(glGetUniformLocation(sortShaders.scatter->ID, "bitShift"), shift);
+        glDispatchCompute(sortWorkGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        std::swap(keysIn, keysOut);
+    }
+
+    // An even pass count leaves the sorted keys back in mortonBuffer.
+    static_assert((32 / radixBits) % 2 == 0, "radix sort must finish in the source buffer");
+    if (keyBits == 64) {
+        MyglobalLogger().logMessage(Logger::DEBUG, "LBVH radix sort ran 16 passes for 63-bit Morton codes", __FILE__, __LINE__);
+    }
+}
+
+void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+    Shader* mortonShader, const RadixSortShaders& sortShaders, Shader* hierarchyShader, Shader* aabbShader) {
+
+    if (isBuildPending()) {
+        MyglobalLogger().logMessage(Logger::DEBUG, "LBVH build already in flight - request ignored", __FILE__, __LINE__);
         return;
     }
 
-    GLuint elemBuffer, mortonBuffer;
-    glGenBuffers(1, &elemBuffer);
-    glGenBuffers(1, &mortonBuffer);
+    uint32_t numTris = indices.size() / 3;
+    if (numTris == 0) {
+        MyglobalLogger().logMessage(Logger::ERROR, "No triangles to build LBVH", __FILE__, __LINE__);
+        return;
+    }
+
+    if (buildQuality == BVHBuildQuality::BinnedSAH) {
+        // The compute pipeline only produces Morton trees.
+        buildLBVHParallelCPU(positions, indices);
+        return;
+    }
+
+    MyglobalLogger().logMessage(Logger::INFO, "Building LBVH for " + std::to_string(numTris) + " triangles", __FILE__, __LINE__);
+
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, elemBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, numTris * sizeof(Element), gpuElements.data(), GL_STATIC_DRAW);
+    if (!glfwGetCurrentContext()) {
+        MyglobalLogger().logMessage(Logger::ERROR, "No OpenGL context available!", __FILE__, __LINE__);
+        return;
+    }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mortonBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, numTris * sizeof(MortonCodeElement), nullptr, GL_DYNAMIC_COPY);
+    // The current tree and its primitives stay in use until the fence signals.
+    std::vector<Primitive> currentPrimitives = std::move(primitives);
+    AABB globalAABB;
+    const bool boundsValid = computePrimitiveBounds(positions, indices, globalAABB);
+    pendingPrimitives = std::move(primitives);
+    primitives = std::move(currentPrimitives);
+    if (!boundsValid) {
+        pendingPrimitives.clear();
+        return;
+    }
+
+    // Element and node buffers persist across rebuilds and only grow; the element buffer
+    // is filled through its persistent mapping when ARB_buffer_storage is available.
+    const uint32_t totalNodes = 2 * numTris - 1;
+    elementBuffer.reserve(numTris * sizeof(Element));
+    mortonBuffer.reserve(numTris * sizeof(MortonCodeElement));
+    nodeBuffer.reserve(totalNodes * sizeof(LBVHNode));
+    constructionBuffer.reserve(totalNodes * sizeof(LBVHConstructionInfo));
+
+    Element* gpuElements = static_cast<Element*>(elementBuffer.getMappedPointer());
+    std::vector<Element> stagedElements;
+    if (!gpuElements) {
+        stagedElements.resize(numTris);
+        gpuElements = stagedElements.data();
+    }
+    for (size_t i = 0; i < numTris; ++i) {
+        gpuElements[i].primitiveIdx = pendingPrimitives[i].index;
+        gpuElements[i].aabbMinX = pendingPrimitives[i].aabb.min.x;
+        gpuElements[i].aabbMinY = pendingPrimitives[i].aabb.min.y;
+        gpuElements[i].aabbMinZ = pendingPrimitives[i].aabb.min.z;
+        gpuElements[i].aabbMaxX = pendingPrimitives[i].aabb.max.x;
+        gpuElements[i].aabbMaxY = pendingPrimitives[i].aabb.max.y;
+        gpuElements[i].aabbMaxZ = pendingPrimitives[i].aabb.max.z;
+    }
+
+    glm::vec3 extent = globalAABB.max - globalAABB.min;
+
+    if (!stagedElements.empty()) {
+        elementBuffer.upload(stagedElements.data(), numTris * sizeof(Element));
+    }
 
     glUseProgram(mortonShader->ID);
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, elemBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mortonBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, elementBuffer.getID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mortonBuffer.getID());
 
     glUniform3fv(glGetUniformLocation(mortonShader->ID, "sceneMin"), 1, glm::value_ptr(globalAABB.min));
     extent = glm::max(extent, glm::vec3(0.0001f)); 
     glUniform3fv(glGetUniformLocation(mortonShader->ID, "sceneExtent"), 1, glm::value_ptr(extent));
     glUniform1ui(glGetUniformLocation(mortonShader->ID, "numElements"), numTris);
+    glUniform1ui(glGetUniformLocation(mortonShader->ID, "wideCodes"), mortonPrecision == MortonPrecision::Bits63 ? 1u : 0u);
 
     uint32_t workGroups = (numTris + 255) / 256;
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
     glDispatchCompute(workGroups, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    glFinish();
 
-    MyglobalLogger().logMessage(Logger::INFO, "Morton codes computed successfully", __FILE__, __LINE__);
-    std::vector<MortonCodeElement> mortonData(numTris);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mortonBuffer);
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numTris * sizeof(MortonCodeElement), mortonData.data());
+    sortMortonCodesGPU(numTris, sortShaders);
 
-    if (mortonData.size() >= 3) {
-        MyglobalLogger().logMessage(Logger::DEBUG,
-            "First Morton codes: [0]=" + std::to_string(mortonData[0].mortonCode) +
-            " [1]=" + std::to_string(mortonData[1].mortonCode) +
-            " [2]=" + std::to_string(mortonData[2].mortonCode), __FILE__, __LINE__);
+    glUseProgram(hierarchyShader->ID);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mortonBuffer.getID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, elementBuffer.getID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, nodeBuffer.getID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, constructionBuffer.getID());
+    duplicateBuffer.reserve(sizeof(uint32_t));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, duplicateBuffer.getID());
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, duplicateBuffer.getID());
+
+    glUniform1ui(glGetUniformLocation(hierarchyShader->ID, "numElements"), numTris);
+    glUniform1ui(glGetUniformLocation(hierarchyShader->ID, "absolutePointers"), 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glDispatchCompute(workGroups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glUseProgram(aabbShader->ID);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, nodeBuffer.getID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, constructionBuffer.getID());
+
+    glUniform1ui(glGetUniformLocation(aabbShader->ID, "numElements"), numTris);
+    glUniform1ui(glGetUniformLocation(aabbShader->ID, "absolutePointers"), 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glDispatchCompute(workGroups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    // No glFinish: the fence is polled once per frame by pollGPUBuild.
+    buildFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    pendingNumTris = numTris;
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        MyglobalLogger().logMessage(Logger::ERROR,
+            "OpenGL error after LBVH dispatch: " + std::to_string(error), __FILE__, __LINE__);
+    }
+}
+
+bool BVH::pollGPUBuild() {
+    if (!buildFence) {
+        return false;
+    }
+
+    const GLenum status = glClientWaitSync(buildFence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    glDeleteSync(buildFence);
+    buildFence = nullptr;
+
+    if (status == GL_WAIT_FAILED) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Waiting on the LBVH build fence failed", __FILE__, __LINE__);
+        pendingPrimitives.clear();
+        return false;
+    }
+
+    const uint32_t numTris = pendingNumTris;
+    const uint32_t totalNodes = 2 * numTris - 1;
+
+    // Swap the finished tree in; everything below runs on CPU-visible data only.
+    primitives = std::move(pendingPrimitives);
+    pendingPrimitives.clear();
+    m_bvh.resize(totalNodes);
+    nodeBuffer.download(m_bvh.data(), totalNodes * sizeof(LBVHNode));
+    mortonCodes.clear();
+    uint32_t duplicates = 0;
+    duplicateBuffer.download(&duplicates, sizeof(duplicates));
+    logDuplicateCodeRate(duplicates, numTris);
+
+    if (buildQuality == BVHBuildQuality::TreeletOptimized) {
+        optimizeTreelets();
     }
+    captureRefitState();
+    uploadNodeInstances(numTris);
+
+    MyglobalLogger().logMessage(Logger::INFO,
+        "LBVH build completed successfully with " + std::to_string(numInternalNodes) + " visualization nodes",
+        __FILE__, __LINE__);
+    return true;
+}
 
-    std::sort(mortonData.begin(), mortonData.end(), [](const MortonCodeElement& a, const MortonCodeElement& b) {
-        if (a.mortonCode == b.mortonCode) {
-            return a.elementIdx < b.elementIdx; 
+void BVH::buildLBVHParallelCPU(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+    m_bvh.clear();
+    primitives.clear();
+    mortonCodes.clear();
+
+    const uint32_t numTris = static_cast<uint32_t>(indices.size() / 3);
+    if (numTris == 0) {
+        MyglobalLogger().logMessage(Logger::ERROR, "No triangles to build LBVH", __FILE__, __LINE__);
+        return;
+    }
+
+    ThreadPool& pool = globalThreadPool();
+    MyglobalLogger().logMessage(Logger::INFO, "Building LBVH on CPU for " + std::to_string(numTris) +
+        " triangles using " + std::to_string(pool.getThreadCount()) + " threads", __FILE__, __LINE__);
+
+    AABB globalAABB;
+    if (!computePrimitiveBounds(positions, indices, globalAABB)) {
+        return;
+    }
+
+    buildFromPrimitivesCPU(globalAABB);
+}
+
+void BVH::buildLBVHFromBounds(const std::vector<AABB>& bounds) {
+    m_bvh.clear();
+    primitives.clear();
+    mortonCodes.clear();
+
+    if (bounds.empty()) {
+        return;
+    }
+
+    AABB globalAABB;
+    primitives.resize(bounds.size());
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        primitives[i].aabb = bounds[i];
+        primitives[i].index = static_cast<uint32_t>(i);
+        globalAABB.expand(bounds[i].min);
+        globalAABB.expand(bounds[i].max);
+    }
+
+    buildFromPrimitivesCPU(globalAABB);
+}
+
+void BVH::adoptNodes(std::vector<LBVHNode> nodes) {
+    m_bvh = std::move(nodes);
+    primitives.clear();
+    mortonCodes.clear();
+    numInternalNodes = 0;
+    captureRefitState();
+}
+
+void BVH::buildFromPrimitivesCPU(const AABB& globalAABB) {
+    const uint32_t numTris = static_cast<uint32_t>(primitives.size());
+
+    if (buildQuality == BVHBuildQuality::BinnedSAH) {
+        buildBinnedSAH();
+    }
+    else {
+        buildMortonHierarchyCPU(globalAABB);
+        if (buildQuality == BVHBuildQuality::TreeletOptimized) {
+            optimizeTreelets();
         }
-        return a.mortonCode < b.mortonCode;
-        });
+    }
 
-    MyglobalLogger().logMessage(Logger::INFO, "Morton codes sorted successfully", __FILE__, __LINE__);
+    captureRefitState();
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mortonBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, numTris * sizeof(MortonCodeElement), mortonData.data(), GL_STATIC_DRAW);
+    if (uploadVisualization && glfwGetCurrentContext()) {
+        uploadNodeInstances(numTris);
+    }
+    else {
+        numInternalNodes = 0;
+    }
 
-    GLuint lbvhBuffer, lbvhConstructionBuffer;
-    glGenBuffers(1, &lbvhBuffer);
-    glGenBuffers(1, &lbvhConstructionBuffer);
+    MyglobalLogger().logMessage(Logger::DEBUG,
+        "CPU BVH build completed with " + std::to_string(m_bvh.size()) + " nodes, SAH cost " + std::to_string(builtSAHCost),
+        __FILE__, __LINE__);
+}
 
-    struct LBVHNode {
-        int32_t left, right;
-        uint32_t primitiveIdx;
-        float aabbMinX, aabbMinY, aabbMinZ;
-        float aabbMaxX, aabbMaxY, aabbMaxZ;
+void BVH::logDuplicateCodeRate(size_t duplicates, size_t codeCount) {
+    lastDuplicateCodeRate = codeCount == 0 ? 0.0f : static_cast<float>(duplicates) / codeCount;
+
+    // Per-mesh BLAS and the TLAS rebuild often; only the visualized tree reports at INFO.
+    MyglobalLogger().logMessage(uploadVisualization ? Logger::INFO : Logger::DEBUG,
+        std::string(mortonPrecision == MortonPrecision::Bits63 ? "63" : "30") + "-bit Morton codes: " +
+        std::to_string(duplicates) + " of " + std::to_string(codeCount) + " duplicate (" +
+        std::to_string(lastDuplicateCodeRate * 100.0f) + "%)", __FILE__, __LINE__);
+}
+
+void BVH::buildMortonHierarchyCPU(const AABB& globalAABB) {
+    ThreadPool& pool = globalThreadPool();
+    const uint32_t numTris = static_cast<uint32_t>(primitives.size());
+
+    const glm::vec3 sceneMin = globalAABB.min;
+    const glm::vec3 sceneExtent = glm::max(globalAABB.max - globalAABB.min, glm::vec3(0.0001f));
+
+    mortonCodes.resize(numTris);
+    pool.parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 center = (primitives[i].aabb.min + primitives[i].aabb.max) * 0.5f;
+            mortonCodes[i].mortonCode = morton3D(center, sceneMin, sceneExtent, mortonPrecision);
+            mortonCodes[i].elementIdx = static_cast<uint32_t>(i);
+            mortonCodes[i].padding = 0;
+        }
+    });
+
+    radixSortMortonCodes(mortonCodes, mortonKeyBits(mortonPrecision), pool);
+    size_t duplicates = 0;
+    for (size_t i = 1; i < mortonCodes.size(); ++i) {
+        duplicates += mortonCodes[i].mortonCode == mortonCodes[i - 1].mortonCode;
+    }
+    logDuplicateCodeRate(duplicates, mortonCodes.size());
+
+    const uint32_t totalNodes = 2 * numTris - 1;
+    const int numElements = static_cast<int>(numTris);
+    const int leafOffset = numElements - 1;
+    const MortonCodeElement* sortedCodes = mortonCodes.data();
+
+    m_bvh.assign(totalNodes, LBVHNode{});
+    std::vector<LBVHConstructionInfo> constructionInfos(totalNodes, LBVHConstructionInfo{ 0, 0 });
+
+    pool.parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        for (size_t gID = begin; gID < end; ++gID) {
+            const Primitive& primitive = primitives[sortedCodes[gID].elementIdx];
+            m_bvh[leafOffset + gID] = LBVHNode{
+                -1, -1, primitive.index,
+                primitive.aabb.min.x, primitive.aabb.min.y, primitive.aabb.min.z,
+                primitive.aabb.max.x, primitive.aabb.max.y, primitive.aabb.max.z
+            };
+
+            if (static_cast<int>(gID) < leafOffset) {
+                int first, last;
+                determineRange(sortedCodes, numElements, static_cast<int>(gID), first, last);
+                const int split = findSplit(sortedCodes, numElements, first, last);
+
+                const int childA = (split == first) ? leafOffset + split : split;
+                const int childB = (split + 1 == last) ? leafOffset + split + 1 : split + 1;
+
+                m_bvh[gID] = LBVHNode{ childA, childB, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+                constructionInfos[childA] = LBVHConstructionInfo{ static_cast<uint32_t>(gID), 0 };
+                constructionInfos[childB] = LBVHConstructionInfo{ static_cast<uint32_t>(gID), 0 };
+            }
+        }
+    });
+
+    // Bottom-up refit: the first thread to reach a node stops, the second one sees both
+    // children finished (acquire on the counter) and writes the union.
+    pool.parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        for (size_t gID = begin; gID < end; ++gID) {
+            uint32_t nodeIdx = constructionInfos[leafOffset + gID].parent;
+
+            while (static_cast<int>(nodeIdx) < leafOffset) {
+                std::atomic_ref<int> visitations(constructionInfos[nodeIdx].visitationCount);
+                if (visitations.fetch_add(1, std::memory_order_acq_rel) == 0) {
+                    break;
+                }
+
+                LBVHNode& node = m_bvh[nodeIdx];
+                unionChildBounds(node, m_bvh[node.left], m_bvh[node.right]);
+
+                if (nodeIdx == 0) {
+                    break;
+                }
+                nodeIdx = constructionInfos[nodeIdx].parent;
+            }
+        }
+    }, 256);
+
+    MyglobalLogger().logMessage(Logger::DEBUG, "LBVH hierarchy and AABBs constructed on CPU", __FILE__, __LINE__);
+}
+
+void BVH::buildBinnedSAH() {
+    ThreadPool& pool = globalThreadPool();
+    const uint32_t numPrims = static_cast<uint32_t>(primitives.size());
+    const uint32_t leafOffset = numPrims - 1;
+
+    m_bvh.assign(2 * static_cast<size_t>(numPrims) - 1, LBVHNode{});
+
+    std::vector<uint32_t> order(numPrims);
+    std::vector<glm::vec3> centroids(numPrims);
+    pool.parallelFor(0, numPrims, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+            centroids[i] = (primitives[i].aabb.min + primitives[i].aabb.max) * 0.5f;
+        }
+    });
+
+    // Ranges are inclusive positions in `order`. Internal nodes take the Karras numbering
+    // (left child = its last position, right child = its first, root = 0), so the tree
+    // keeps the LBVH layout: internal nodes in [0, n-1), leaf for position p at n-1+p.
+    struct SAHTask {
+        uint32_t nodeIdx;
+        uint32_t first;
+        uint32_t last;
     };
 
-    struct LBVHConstructionInfo {
-        uint32_t parent;
-        int32_t visitationCount;
+    auto emitLeaf = [&](uint32_t position) {
+        const Primitive& primitive = primitives[order[position]];
+        LBVHNode& leaf = m_bvh[leafOffset + position];
+        leaf.left = -1;
+        leaf.right = -1;
+        leaf.primitiveIdx = primitive.index;
+        setNodeBounds(leaf, primitive.aabb);
+        return static_cast<int>(leafOffset + position);
     };
 
-    uint32_t totalNodes = 2 * numTris - 1;
+    auto splitTask = [&](const SAHTask& task, SAHTask* children, int& childCount) {
+        AABB bounds;
+        AABB centroidBounds;
+        for (uint32_t i = task.first; i <= task.last; ++i) {
+            bounds = unionBounds(bounds, primitives[order[i]].aabb);
+            centroidBounds.expand(centroids[order[i]]);
+        }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lbvhBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, totalNodes * sizeof(LBVHNode), nullptr, GL_DYNAMIC_COPY);
+        const uint32_t count = task.last - task.first + 1;
+        const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        uint32_t split = task.first + count / 2 - 1;
+
+        if (count > 2) {
+            float bestCost = FLT_MAX;
+            int bestAxis = -1;
+            int bestBin = 0;
+
+            for (int axis = 0; axis < 3; ++axis) {
+                if (extent[axis] <= 1e-12f) {
+                    continue;
+                }
+                const float binScale = kSAHBins * 0.99999f / extent[axis];
+
+                std::array<AABB, kSAHBins> binBounds{};
+                std::array<uint32_t, kSAHBins> binCounts{};
+                for (uint32_t i = task.first; i <= task.last; ++i) {
+                    const int bin = std::min(kSAHBins - 1, static_cast<int>((centroids[order[i]][axis] - centroidBounds.min[axis]) * binScale));
+                    binCounts[bin]++;
+                    binBounds[bin] = unionBounds(binBounds[bin], primitives[order[i]].aabb);
+                }
+
+                std::array<float, kSAHBins> rightCost{};
+                AABB rightBounds;
+                uint32_t rightCount = 0;
+                for (int bin = kSAHBins - 1; bin > 0; --bin) {
+                    rightBounds = unionBounds(rightBounds, binBounds[bin]);
+                    rightCount += binCounts[bin];
+                    rightCost[bin] = rightCount ? rightCount * surfaceArea(rightBounds) : 0.0f;
+                }
+
+                AABB leftBounds;
+                uint32_t leftCount = 0;
+                for (int bin = 0; bin < kSAHBins - 1; ++bin) {
+                    leftBounds = unionBounds(leftBounds, binBounds[bin]);
+                    leftCount += binCounts[bin];
+                    if (leftCount == 0 || leftCount == count) {
+                        continue;
+                    }
+                    const float cost = leftCount * surfaceArea(leftBounds) + rightCost[bin + 1];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lbvhConstructionBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, totalNodes * sizeof(LBVHConstructionInfo), nullptr, GL_DYNAMIC_COPY);
+            bool partitioned = false;
+            if (bestAxis >= 0) {
+                const float binScale = kSAHBins * 0.99999f / extent[bestAxis];
+                const float axisMin = centroidBounds.min[bestAxis];
+                auto middle = std::partition(order.begin() + task.first, order.begin() + task.last + 1, [&](uint32_t prim) {
+                    return std::min(kSAHBins - 1, static_cast<int>((centroids[prim][bestAxis] - axisMin) * binScale)) <= bestBin;
+                });
+                const uint32_t leftCount = static_cast<uint32_t>(middle - (order.begin() + task.first));
+                if (leftCount > 0 && leftCount < count) {
+                    split = task.first + leftCount - 1;
+                    partitioned = true;
+                }
+            }
 
-    glUseProgram(hierarchyShader->ID);
+            if (!partitioned) {
+                // Coincident centroids: fall back to a median split on the widest axis.
+                const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+                std::nth_element(order.begin() + task.first, order.begin() + split + 1, order.begin() + task.last + 1,
+                    [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+            }
+        }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mortonBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, elemBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lbvhBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lbvhConstructionBuffer);
+        LBVHNode& node = m_bvh[task.nodeIdx];
+        node.primitiveIdx = 0;
+        setNodeBounds(node, bounds);
 
-    glUniform1ui(glGetUniformLocation(hierarchyShader->ID, "numElements"), numTris);
-    glUniform1ui(glGetUniformLocation(hierarchyShader->ID, "absolutePointers"), 1);
+        childCount = 0;
+        if (split == task.first) {
+            node.left = emitLeaf(split);
+        }
+        else {
+            node.left = static_cast<int>(split);
+            children[childCount++] = SAHTask{ split, task.first, split };
+        }
+        if (split + 1 == task.last) {
+            node.right = emitLeaf(split + 1);
+        }
+        else {
+            node.right = static_cast<int>(split + 1);
+            children[childCount++] = SAHTask{ split + 1, split + 1, task.last };
+        }
+    };
 
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    glDispatchCompute(workGroups, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    glFinish();
+    if (numPrims == 1) {
+        emitLeaf(0);
+        return;
+    }
+
+    // Split the top of the tree serially until there is enough independent work,
+    // then finish the subtrees on the pool.
+    const size_t targetTasks = static_cast<size_t>(pool.getThreadCount()) * 8;
+    std::vector<SAHTask> pending{ SAHTask{ 0, 0, numPrims - 1 } };
+    std::vector<SAHTask> subtrees;
+    while (!pending.empty()) {
+        const SAHTask task = pending.back();
+        pending.pop_back();
+        if (task.last - task.first + 1 <= kSAHParallelCutoff || pending.size() + subtrees.size() >= targetTasks) {
+            subtrees.push_back(task);
+            continue;
+        }
+        SAHTask children[2];
+        int childCount;
+        splitTask(task, children, childCount);
+        for (int i = 0; i < childCount; ++i) {
+            pending.push_back(children[i]);
+        }
+    }
 
-    MyglobalLogger().logMessage(Logger::INFO, "LBVH hierarchy constructed", __FILE__, __LINE__);
+    pool.parallelFor(0, subtrees.size(), [&](size_t begin, size_t end) {
+        std::vector<SAHTask> stack;
+        for (size_t i = begin; i < end; ++i) {
+            stack.push_back(subtrees[i]);
+            while (!stack.empty()) {
+                const SAHTask task = stack.back();
+                stack.pop_back();
+                SAHTask children[2];
+                int childCount;
+                splitTask(task, children, childCount);
+                for (int c = 0; c < childCount; ++c) {
+                    stack.push_back(children[c]);
+                }
+            }
+        }
+    }, 1);
+}
 
-    glUseProgram(aabbShader->ID);
+void BVH::optimizeTreelets() {
+    const uint32_t totalNodes = static_cast<uint32_t>(m_bvh.size());
+    if (totalNodes < 5) {
+        return;
+    }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lbvhBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lbvhConstructionBuffer);
+    ThreadPool& pool = globalThreadPool();
+    const uint32_t leafOffset = (totalNodes + 1) / 2 - 1;
+    const uint32_t numLeaves = totalNodes - leafOffset;
+    std::vector<float> subtreeCost(totalNodes, 0.0f);
+
+    // Karras & Aila style restructuring: grow a treelet of up to kTreeletLeaves under each
+    // node, find its optimal topology by dynamic programming over leaf subsets and rewire the
+    // treelet's internal slots if that lowers the SAH cost. Nodes are visited bottom-up with
+    // the refit visitation scheme, so a treelet only ever touches finished descendants.
+    auto restructure = [&](uint32_t root) {
+        int leaves[kTreeletLeaves];
+        int internals[kTreeletLeaves - 1];
+        int leafCount = 2;
+        int internalCount = 1;
+        internals[0] = static_cast<int>(root);
+        leaves[0] = m_bvh[root].left;
+        leaves[1] = m_bvh[root].right;
+
+        while (leafCount < kTreeletLeaves) {
+            int expand = -1;
+            float largestArea = -1.0f;
+            for (int i = 0; i < leafCount; ++i) {
+                if (static_cast<uint32_t>(leaves[i]) < leafOffset) {
+                    const float area = surfaceArea(nodeBounds(m_bvh[leaves[i]]));
+                    if (area > largestArea) {
+                        largestArea = area;
+                        expand = i;
+                    }
+                }
+            }
+            if (expand < 0) {
+                break;
+            }
+            const LBVHNode& node = m_bvh[leaves[expand]];
+            internals[internalCount++] = leaves[expand];
+            leaves[expand] = node.left;
+            leaves[leafCount++] = node.right;
+        }
 
-    glUniform1ui(glGetUniformLocation(aabbShader->ID, "numElements"), numTris);
-    glUniform1ui(glGetUniformLocation(aabbShader->ID, "absolutePointers"), 1);
+        const float currentCost = kTraversalCost * surfaceArea(nodeBounds(m_bvh[root])) +
+            subtreeCost[m_bvh[root].left] + subtreeCost[m_bvh[root].right];
+        if (leafCount < 3) {
+            subtreeCost[root] = currentCost;
+            return;
+        }
 
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    glDispatchCompute(workGroups, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-    glFinish();
+        constexpr int kSubsets = 1 << kTreeletLeaves;
+        const int fullMask = (1 << leafCount) - 1;
+        AABB subsetBounds[kSubsets];
+        float subsetCost[kSubsets];
+        int bestPartition[kSubsets];
+
+        for (int mask = 1; mask <= fullMask; ++mask) {
+            const int lowest = std::countr_zero(static_cast<unsigned>(mask));
+            const int rest = mask & (mask - 1);
+            if (rest == 0) {
+                subsetBounds[mask] = nodeBounds(m_bvh[leaves[lowest]]);
+                subsetCost[mask] = subtreeCost[leaves[lowest]];
+                continue;
+            }
+            subsetBounds[mask] = unionBounds(subsetBounds[rest], nodeBounds(m_bvh[leaves[lowest]]));
+
+            float best = FLT_MAX;
+            const int lowestBit = mask & -mask;
+            for (int sub = (mask - 1) & mask; sub > 0; sub = (sub - 1) & mask) {
+                if ((sub & lowestBit) == 0) {
+                    continue;
+                }
+                const float cost = subsetCost[sub] + subsetCost[mask ^ sub];
+                if (cost < best) {
+                    best = cost;
+                    bestPartition[mask] = sub;
+                }
+            }
+            subsetCost[mask] = kTraversalCost * surfaceArea(subsetBounds[mask]) + best;
+        }
 
-    MyglobalLogger().logMessage(Logger::INFO, "LBVH AABB computed", __FILE__, __LINE__);
+        if (subsetCost[fullMask] >= currentCost * 0.9999f) {
+            subtreeCost[root] = currentCost;
+            return;
+        }
+
+        int nextSlot = 1;
+        auto rebuild = [&](auto& self, int mask, int nodeIdx) -> void {
+            const int sides[2] = { bestPartition[mask], mask ^ bestPartition[mask] };
+            int children[2];
+            for (int side = 0; side < 2; ++side) {
+                if ((sides[side] & (sides[side] - 1)) == 0) {
+                    children[side] = leaves[std::countr_zero(static_cast<unsigned>(sides[side]))];
+                }
+                else {
+                    children[side] = internals[nextSlot++];
+                    self(self, sides[side], children[side]);
+                }
+            }
+            LBVHNode& node = m_bvh[nodeIdx];
+            node.left = children[0];
+            node.right = children[1];
+            setNodeBounds(node, subsetBounds[mask]);
+            subtreeCost[nodeIdx] = subsetCost[mask];
+        };
+        rebuild(rebuild, fullMask, static_cast<int>(root));
+    };
 
-    std::vector<LBVHNode> lbvhNodes(totalNodes);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lbvhBuffer);
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, totalNodes * sizeof(LBVHNode), lbvhNodes.data());
+    for (int pass = 0; pass < kTreeletPasses; ++pass) {
+        captureRefitState();
+        std::vector<int> visitations(leafOffset, 0);
+
+        pool.parallelFor(0, numLeaves, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t leafIdx = leafOffset + static_cast<uint32_t>(i);
+                subtreeCost[leafIdx] = kIntersectionCost * surfaceArea(nodeBounds(m_bvh[leafIdx]));
+
+                uint32_t nodeIdx = nodeParents[leafIdx];
+                while (nodeIdx < leafOffset) {
+                    std::atomic_ref<int> visited(visitations[nodeIdx]);
+                    if (visited.fetch_add(1, std::memory_order_acq_rel) == 0) {
+                        break;
+                    }
+                    restructure(nodeIdx);
+                    nodeIdx = nodeParents[nodeIdx];
+                }
+            }
+        }, 256);
+    }
+}
+
+float BVH::computeSAHCost() const {
+    if (m_bvh.empty()) {
+        return 0.0f;
+    }
+
+    const float rootArea = surfaceArea(nodeBounds(m_bvh[0]));
+    if (rootArea <= 0.0f) {
+        return 0.0f;
+    }
+
+    // Normalizing by the root area keeps costs comparable across uniform scales of the same tree.
+    const size_t leafOffset = (m_bvh.size() + 1) / 2 - 1;
+    double cost = 0.0;
+    for (size_t i = 0; i < m_bvh.size(); ++i) {
+        cost += surfaceArea(nodeBounds(m_bvh[i])) * (i < leafOffset ? kTraversalCost : kIntersectionCost);
+    }
+    return static_cast<float>(cost / rootArea);
+}
+
+void BVH::captureRefitState() {
+    nodeParents.assign(m_bvh.size(), UINT32_MAX);
+    const uint32_t leafOffset = static_cast<uint32_t>((m_bvh.size() + 1) / 2 - 1);
+    for (uint32_t i = 0; i < leafOffset; ++i) {
+        const LBVHNode& node = m_bvh[i];
+        if (node.left >= 0 && static_cast<size_t>(node.left) < m_bvh.size()) {
+            nodeParents[node.left] = i;
+        }
+        if (node.right >= 0 && static_cast<size_t>(node.right) < m_bvh.size()) {
+            nodeParents[node.right] = i;
+        }
+    }
+    builtSAHCost = computeSAHCost();
+    lastSAHCostRatio = 1.0f;
+}
+
+bool BVH::refit(const std::vector<glm::vec3>& objectPositions, const std::vector<uint32_t>& indices, const glm::mat4& transform) {
+    const uint32_t numTris = static_cast<uint32_t>(indices.size() / 3);
+    if (numTris == 0 || m_bvh.size() != 2 * static_cast<size_t>(numTris) - 1 || nodeParents.size() != m_bvh.size()) {
+        return false;
+    }
+
+    ThreadPool& pool = globalThreadPool();
+    const uint32_t leafOffset = numTris - 1;
+    const bool updatePrimitives = primitives.size() == numTris;
+    std::atomic<bool> indicesValid = true;
+
+    pool.parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            LBVHNode& leaf = m_bvh[leafOffset + i];
+            const uint32_t tri = leaf.primitiveIdx;
+            if (tri >= numTris || indices[tri * 3] >= objectPositions.size() ||
+                indices[tri * 3 + 1] >= objectPositions.size() || indices[tri * 3 + 2] >= objectPositions.size()) {
+                indicesValid.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            AABB bounds;
+            bounds.expand(glm::vec3(transform * glm::vec4(objectPositions[indices[tri * 3]], 1.0f)));
+            bounds.expand(glm::vec3(transform * glm::vec4(objectPositions[indices[tri * 3 + 1]], 1.0f)));
+            bounds.expand(glm::vec3(transform * glm::vec4(objectPositions[indices[tri * 3 + 2]], 1.0f)));
+
+            leaf.aabbMinX = bounds.min.x; leaf.aabbMinY = bounds.min.y; leaf.aabbMinZ = bounds.min.z;
+            leaf.aabbMaxX = bounds.max.x; leaf.aabbMaxY = bounds.max.y; leaf.aabbMaxZ = bounds.max.z;
+            if (updatePrimitives) {
+                primitives[tri].aabb = bounds;
+            }
+        }
+    });
+
+    if (!indicesValid.load()) {
+        MyglobalLogger().logMessage(Logger::WARNING, "LBVH refit source does not match the built tree - rebuild required", __FILE__, __LINE__);
+        return false;
+    }
+
+    // Same visitation scheme as the build: the second child to arrive unions the node.
+    std::vector<int> visitations(leafOffset, 0);
+    pool.parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t nodeIdx = nodeParents[leafOffset + i];
+            while (nodeIdx < leafOffset) {
+                std::atomic_ref<int> visited(visitations[nodeIdx]);
+                if (visited.fetch_add(1, std::memory_order_acq_rel) == 0) {
+                    break;
+                }
+                LBVHNode& node = m_bvh[nodeIdx];
+                unionChildBounds(node, m_bvh[node.left], m_bvh[node.right]);
+                nodeIdx = nodeParents[nodeIdx];
+            }
+        }
+    }, 256);
+
+    lastSAHCostRatio = (builtSAHCost > 0.0f) ? computeSAHCost() / builtSAHCost : 1.0f;
+    if (lastSAHCostRatio > refitQualityThreshold) {
+        MyglobalLogger().logMessage(Logger::INFO,
+            "LBVH refit SAH cost grew x" + std::to_string(lastSAHCostRatio) + " - rebuild required", __FILE__, __LINE__);
+        return false;
+    }
+
+    if (uploadVisualization && glfwGetCurrentContext()) {
+        uploadNodeInstances(numTris);
+    }
+    return true;
+}
+
+void BVH::uploadNodeInstances(uint32_t numTris) {
+    const uint32_t totalNodes = static_cast<uint32_t>(m_bvh.size());
 
     std::vector<glm::vec3> instanceData;
     uint32_t validNodeCount = 0;
@@ -204,7 +1091,7 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
     const uint32_t nodeEnd = (numTris > 1) ? (numTris - 1) : totalNodes;
 
     for (uint32_t i = nodeBegin; i < nodeEnd; ++i) {
-        const LBVHNode& node = lbvhNodes[i];
+        const LBVHNode& node = m_bvh[i];
 
         glm::vec3 nodeMin(node.aabbMinX, node.aabbMinY, node.aabbMinZ);
         glm::vec3 nodeMax(node.aabbMaxX, node.aabbMaxY, node.aabbMaxZ);
@@ -252,34 +1139,17 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
         __FILE__, __LINE__);
 
     if (numInternalNodes > 0) {
+        // Capacity-grown storage: refits and same-size rebuilds only update its contents.
+        const bool reallocated = aabbInstanceBuffer.reserve(instanceData.size() * sizeof(glm::vec3));
+        aabbInstanceBuffer.upload(instanceData.data(), instanceData.size() * sizeof(glm::vec3));
 
-        if (aabbInstanceVBO != 0) {
-            glDeleteBuffers(1, &aabbInstanceVBO);
-            aabbInstanceVBO = 0;
-        }
-
-        glGenBuffers(1, &aabbInstanceVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, aabbInstanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(glm::vec3), instanceData.data(), GL_STATIC_DRAW);
-
-        GLint bufferSize;
-        glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
-        GLint expectedSize = instanceData.size() * sizeof(glm::vec3);
-
-        if (bufferSize != expectedSize) {
-            MyglobalLogger().logMessage(Logger::ERROR,
-                "VBO creation failed: expected " + std::to_string(expectedSize) +
-                " bytes, got " + std::to_string(bufferSize), __FILE__, __LINE__);
-        }
-        else {
+        if (reallocated) {
             MyglobalLogger().logMessage(Logger::INFO,
-                "LBVH instance VBO created: ID=" + std::to_string(aabbInstanceVBO) +
-                ", size=" + std::to_string(bufferSize) + " bytes, instances=" + std::to_string(numInternalNodes),
+                "LBVH instance VBO allocated: ID=" + std::to_string(aabbInstanceBuffer.getID()) +
+                ", capacity=" + std::to_string(aabbInstanceBuffer.getCapacity()) + " bytes, instances=" + std::to_string(numInternalNodes),
                 __FILE__, __LINE__);
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
         if (instanceData.size() >= 6) {
             MyglobalLogger().logMessage(Logger::DEBUG,
                 "First LBVH instance data: center=(" +
@@ -292,24 +1162,6 @@ void BVH::buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::v
     else {
         MyglobalLogger().logMessage(Logger::WARNING, "No valid LBVH nodes created - visualization will be empty!", __FILE__, __LINE__);
         numInternalNodes = 0;
-        if (aabbInstanceVBO != 0) {
-            glDeleteBuffers(1, &aabbInstanceVBO);
-            aabbInstanceVBO = 0;
-        }
     }
 
-    glDeleteBuffers(1, &elemBuffer);
-    glDeleteBuffers(1, &mortonBuffer);
-    glDeleteBuffers(1, &lbvhBuffer);
-    glDeleteBuffers(1, &lbvhConstructionBuffer);
-
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        MyglobalLogger().logMessage(Logger::ERROR,
-            "OpenGL error after LBVH build: " + std::to_string(error), __FILE__, __LINE__);
-    }
-
-    MyglobalLogger().logMessage(Logger::INFO,
-        "LBVH build completed successfully with " + std::to_string(numInternalNodes) + " visualization nodes",
-        __FILE__, __LINE__);
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include <vector>
+#include <cfloat>
 #include <glm/glm.hpp>
 #include <Shader.hpp>
+#include "GPUBuffer.hpp"
 
 struct AABB {
     glm::vec3 min = glm::vec3(FLT_MAX);
@@ -24,9 +26,12 @@ struct LBVHNode {
     float aabbMaxX, aabbMaxY, aabbMaxZ;
 };
 
+// 16 bytes to match the std430 layout of the shaders' uvec2 code. 30-bit codes leave the
+// upper word zero.
 struct MortonCodeElement {
-    uint32_t mortonCode;
+    uint64_t mortonCode;
     uint32_t elementIdx;
+    uint32_t padding;
 };
 
 struct LBVHConstructionInfo {
@@ -34,22 +39,99 @@ struct LBVHConstructionInfo {
     int visitationCount;
 };
 
+// Fast: Morton LBVH. TreeletOptimized: LBVH followed by treelet restructuring.
+// BinnedSAH: top-down binned SAH; slowest to build, cheapest to traverse.
+enum class BVHBuildQuality {
+    Fast,
+    TreeletOptimized,
+    BinnedSAH
+};
+
+// Bits30: 10 bits per axis (1024^3 grid). Bits63: 21 bits per axis, for dense meshes whose
+// triangles collapse onto duplicate codes at the coarse grid; sorting takes twice the passes.
+enum class MortonPrecision {
+    Bits30,
+    Bits63
+};
+
+struct RadixSortShaders {
+    Shader* histogram = nullptr;
+    Shader* scan = nullptr;
+    Shader* scatter = nullptr;
+};
+
 class BVH {
 public:
     std::vector<Primitive> primitives;
     std::vector<LBVHNode> m_bvh;
     std::vector<MortonCodeElement> mortonCodes;
-    GLuint aabbInstanceVBO = 0;
+    GPUBuffer aabbInstanceBuffer;
     uint32_t numInternalNodes = 0;
 
+    std::vector<uint32_t> nodeParents;
+    float builtSAHCost = 0.0f;
+    float lastSAHCostRatio = 1.0f;
+    float refitQualityThreshold = 1.5f;
+    // Off for trees that are only queried (per-mesh BLAS, TLAS) so they own no GL buffers.
+    bool uploadVisualization = true;
+    BVHBuildQuality buildQuality = BVHBuildQuality::Fast;
+    MortonPrecision mortonPrecision = MortonPrecision::Bits30;
+    // Share of sorted codes equal to their predecessor in the last Morton build.
+    float lastDuplicateCodeRate = 0.0f;
+
     BVH() = default;
     ~BVH() {
-        if (aabbInstanceVBO) {
-            glDeleteBuffers(1, &aabbInstanceVBO);
-            aabbInstanceVBO = 0;
+        if (buildFence) {
+            glDeleteSync(buildFence);
         }
     }
+    BVH(const BVH&) = delete;
+    BVH& operator=(const BVH&) = delete;
 
+    // Issues the compute build and returns without waiting. The current tree stays valid
+    // for drawing and queries until pollGPUBuild() sees the fence and swaps the result in.
     void buildLBVHDynamic(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
-        Shader* mortonShader, Shader* sortShader, Shader* hierarchyShader, Shader* aabbShader);
-};
\ No newline at end of file
+        Shader* mortonShader, const RadixSortShaders& sortShaders, Shader* hierarchyShader, Shader* aabbShader);
+    // Returns true on the call that installs a finished GPU build.
+    bool pollGPUBuild();
+    bool isBuildPending() const { return buildFence != nullptr; }
+
+    // Same Morton/Karras/refit pipeline as buildLBVHDynamic, run on the global thread pool.
+    // Needs no GL context; the visualization VBO is only refreshed when one is current.
+    void buildLBVHParallelCPU(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+    // CPU build over arbitrary primitive boxes; leaf primitiveIdx is the index into `bounds`.
+    void buildLBVHFromBounds(const std::vector<AABB>& bounds);
+    // Takes over a tree built earlier (e.g. read from a mesh cache) instead of building one.
+    void adoptNodes(std::vector<LBVHNode> nodes);
+
+    // Keeps the current topology and recomputes node bounds from the triangles the tree was
+    // built from, placed by `transform`. Returns false when the tree does not match the input
+    // or its SAH cost grew past refitQualityThreshold, in which case the caller should rebuild.
+    bool refit(const std::vector<glm::vec3>& objectPositions, const std::vector<uint32_t>& indices, const glm::mat4& transform);
+    float computeSAHCost() const;
+
+private:
+    // Compute-build scratch, kept and grown across rebuilds.
+    GPUBuffer elementBuffer{ GPUBuffer::Access::Write };
+    GPUBuffer mortonBuffer;
+    GPUBuffer mortonScratchBuffer;
+    GPUBuffer histogramBuffer;
+    GPUBuffer nodeBuffer{ GPUBuffer::Access::Read };
+    GPUBuffer constructionBuffer;
+    // One counter written by lbvh_hierarchy.comp, so the duplicate rate costs a 4-byte read.
+    GPUBuffer duplicateBuffer{ GPUBuffer::Access::Read };
+
+    GLsync buildFence = nullptr;
+    std::vector<Primitive> pendingPrimitives;
+    uint32_t pendingNumTris = 0;
+
+    bool computePrimitiveBounds(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, AABB& globalAABB);
+    void sortMortonCodesGPU(uint32_t numElements, const RadixSortShaders& sortShaders);
+    void buildFromPrimitivesCPU(const AABB& globalAABB);
+    void buildMortonHierarchyCPU(const AABB& globalAABB);
+    void buildBinnedSAH();
+    void optimizeTreelets();
+    void captureRefitState();
+    void uploadNodeInstances(uint32_t numTris);
+    void logDuplicateCodeRate(size_t duplicates, size_t codeCount);
+};
@@ -0,0 +1,151 @@
+#include "MappedFile.hpp"
+#include <cstring>
+#include <utility>
+#include "../src/Logger/Logger.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+// wingdi.h defines ERROR, which would clobber Logger::ERROR below.
+#ifndef NOGDI
+#define NOGDI
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapping = std::exchange(other.mapping, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to open file for mapping: " + path, __FILE__, __LINE__);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to query file size: " + path, __FILE__, __LINE__);
+        return false;
+    }
+
+    fileHandle = file;
+    opened = true;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return true;
+    }
+
+    HANDLE section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!section) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to create file mapping: " + path, __FILE__, __LINE__);
+        close();
+        return false;
+    }
+    mappingHandle = section;
+
+    mapping = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to map view of file: " + path, __FILE__, __LINE__);
+        close();
+        return false;
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to open file for mapping: " + path, __FILE__, __LINE__);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to query file size: " + path, __FILE__, __LINE__);
+        return false;
+    }
+
+    opened = true;
+    length = static_cast<size_t>(fileStat.st_size);
+    if (length == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    // The descriptor can go as soon as the mapping exists.
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        MyglobalLogger().logMessage(Logger::ERROR, "Failed to mmap file: " + path, __FILE__, __LINE__);
+        opened = false;
+        length = 0;
+        return false;
+    }
+    mapping = view;
+#endif
+
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (mapping) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mappingHandle) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+    }
+    if (fileHandle) {
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+    }
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (mapping) {
+        munmap(mapping, length);
+    }
+#endif
+    mapping = nullptr;
+    length = 0;
+    opened = false;
+}
+
+// FNV-1a over 8-byte words, byte-wise for the tail.
+uint64_t hashBytes(std::span<const unsigned char> bytes) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
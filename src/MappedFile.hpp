@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are faulted in on first touch, so
+// only the byte ranges that are actually read cost I/O and resident memory.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+    size_t size() const { return length; }
+    std::span<const unsigned char> bytes() const { return { data(), length }; }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// FNV-1a content hash, used to recognise identical files under different paths.
+uint64_t hashBytes(std::span<const unsigned char> bytes);
@@ -0,0 +1,284 @@
+#include "MaterialTable.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    // A handle belongs to its texture, not to a table: models sharing a cached texture get
+    // the same handle, which may only be made resident once.
+    std::unordered_map<GLuint64, uint32_t>& handleUsers() {
+        static std::unordered_map<GLuint64, uint32_t> users;
+        return users;
+    }
+
+    void retainHandle(GLuint64 handle) {
+        if (handleUsers()[handle]++ == 0) {
+            glMakeTextureHandleResidentARB(handle);
+        }
+    }
+
+    void releaseHandle(GLuint64 handle) {
+        auto found = handleUsers().find(handle);
+        if (found == handleUsers().end()) {
+            return;
+        }
+        if (--found->second == 0) {
+            glMakeTextureHandleNonResidentARB(handle);
+            handleUsers().erase(found);
+        }
+    }
+
+    // Model textures are typed "diffuse", older loaders use "texture_diffuse".
+    bool hasType(const Texture& texture, const char* type) {
+        const char* name = texture.type_r;
+        if (std::strncmp(name, "texture_", 8) == 0) {
+            name += 8;
+        }
+        return std::strcmp(name, type) == 0;
+    }
+
+    bool sameTextures(const std::vector<Texture>& a, const std::vector<Texture>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].ID != b[i].ID) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+const char* MaterialTable::modeName(Mode mode) {
+    switch (mode) {
+    case Mode::Bindless: return "bindless handles";
+    case Mode::Arrays: return "texture arrays";
+    default: return "bound per material";
+    }
+}
+
+MaterialTable::~MaterialTable() {
+    release();
+}
+
+int MaterialTable::addSlot(const Texture& texture) {
+    if (texture.ID == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i].id == texture.ID) {
+            return static_cast<int>(i);
+        }
+    }
+    Slot slot;
+    slot.id = texture.ID;
+    slot.source = texture.cacheHandle;
+    slots.push_back(std::move(slot));
+    return static_cast<int>(slots.size() - 1);
+}
+
+void MaterialTable::build(const std::vector<Mesh>& meshes) {
+    release();
+    slots.clear();
+    materials.clear();
+    meshMaterials.assign(meshes.size(), 0);
+
+    if (GLEW_ARB_bindless_texture) {
+        mode = Mode::Bindless;
+    }
+    else if (GLEW_ARB_copy_image && Texture::hasImmutableStorage()) {
+        mode = Mode::Arrays;
+    }
+    else {
+        mode = Mode::Bound;
+    }
+
+    // Bound mode binds a whole texture list per material, so materials compare whole lists.
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        uint32_t index = static_cast<uint32_t>(materials.size());
+        for (size_t m = 0; m < materials.size(); ++m) {
+            if (sameTextures(meshes[materials[m].mesh].textures, meshes[i].textures)) {
+                index = static_cast<uint32_t>(m);
+                break;
+            }
+        }
+        if (index == materials.size()) {
+            Material material;
+            material.mesh = i;
+            for (const Texture& texture : meshes[i].textures) {
+                if (material.diffuse < 0 && hasType(texture, "diffuse")) {
+                    material.diffuse = addSlot(texture);
+                }
+                else if (material.specular < 0 && hasType(texture, "specular")) {
+                    material.specular = addSlot(texture);
+                }
+            }
+            materials.push_back(material);
+        }
+        meshMaterials[i] = index;
+    }
+
+    if (mode != Mode::Bound) {
+        refresh();
+        upload();
+    }
+    MyglobalLogger().logMessage(Logger::INFO, "Material table: " + std::to_string(materials.size()) + " materials, " +
+        std::to_string(slots.size()) + " textures, " + modeName(mode), __FILE__, __LINE__);
+}
+
+bool MaterialTable::refresh() {
+    bool changed = false;
+    for (Slot& slot : slots) {
+        // Streamed textures hold their placeholder until the cache entry turns resident.
+        if (slot.ready || (slot.source && !slot.source->resident)) {
+            continue;
+        }
+        slot.ready = true;
+        changed = true;
+        if (mode == Mode::Bindless) {
+            // Freezes the texture's levels and parameters, which are final by now.
+            slot.handle = glGetTextureHandleARB(slot.id);
+            if (slot.handle != 0) {
+                retainHandle(slot.handle);
+            }
+        }
+        else if (mode == Mode::Arrays) {
+            addLayer(slot);
+        }
+    }
+    return changed;
+}
+
+void MaterialTable::addLayer(Slot& slot) {
+    LayerArray shape;
+    GLint immutableLevels = 0, maxLevel = 0;
+    glBindTexture(GL_TEXTURE_2D, slot.id);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &shape.width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &shape.height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &shape.format);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &immutableLevels);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, shape.swizzle.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // Mutable textures, such as a failed stream's placeholder, only promise level 0.
+    shape.levels = immutableLevels > 0 ? std::min(immutableLevels, maxLevel + 1) : 1;
+    if (shape.width == 0 || shape.height == 0) {
+        return;
+    }
+
+    auto found = std::find_if(arrays.begin(), arrays.end(), [&shape](const LayerArray& array) {
+        return array.width == shape.width && array.height == shape.height && array.levels == shape.levels &&
+            array.format == shape.format && array.swizzle == shape.swizzle;
+    });
+    if (found == arrays.end()) {
+        if (arrays.size() == kMaxArrays) {
+            MyglobalLogger().logMessage(Logger::WARNING, "More than " + std::to_string(kMaxArrays) +
+                " texture sizes in one model, the rest draw untextured", __FILE__, __LINE__);
+            return;
+        }
+        found = arrays.insert(arrays.end(), shape);
+    }
+    if (found->layers == found->capacity) {
+        growArray(*found, std::max<GLsizei>(kInitialLayers, found->capacity * 2));
+    }
+
+    slot.array = static_cast<uint32_t>(found - arrays.begin());
+    slot.layer = found->layers++;
+    for (GLint level = 0; level < found->levels; ++level) {
+        glCopyImageSubData(slot.id, GL_TEXTURE_2D, level, 0, 0, 0, found->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, slot.layer,
+            std::max(1, found->width >> level), std::max(1, found->height >> level), 1);
+    }
+}
+
+void MaterialTable::growArray(LayerArray& array, GLsizei capacity) {
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.format, array.width, array.height, capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, array.swizzle.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Layers already filled move over in one copy per level.
+    if (array.id != 0) {
+        for (GLint level = 0; level < array.levels && array.layers > 0; ++level) {
+            glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                std::max(1, array.width >> level), std::max(1, array.height >> level), array.layers);
+        }
+        glDeleteTextures(1, &array.id);
+    }
+    array.id = id;
+    array.capacity = capacity;
+}
+
+void MaterialTable::releaseArrays() {
+    for (LayerArray& array : arrays) {
+        glDeleteTextures(1, &array.id);
+    }
+    arrays.clear();
+}
+
+void MaterialTable::upload() {
+    std::vector<MaterialRecord> records(materials.size());
+    for (size_t m = 0; m < materials.size(); ++m) {
+        if (materials[m].diffuse >= 0) {
+            const Slot& slot = slots[materials[m].diffuse];
+            records[m].diffuseHandle = slot.handle;
+            records[m].diffuseLayer = slot.layer;
+            records[m].diffuseArray = slot.array;
+        }
+        if (materials[m].specular >= 0) {
+            const Slot& slot = slots[materials[m].specular];
+            records[m].specularHandle = slot.handle;
+            records[m].specularLayer = slot.layer;
+            records[m].specularArray = slot.array;
+        }
+    }
+    recordBuffer.upload(records.data(), records.size() * sizeof(MaterialRecord));
+}
+
+void MaterialTable::bind(Shader& shader) {
+    if (mode == Mode::Bound || materials.empty()) {
+        shader.setInt("materialMode", 0);
+        return;
+    }
+    if (refresh()) {
+        upload();
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMaterialBinding, recordBuffer.getID());
+    for (size_t a = 0; a < arrays.size(); ++a) {
+        glActiveTexture(GL_TEXTURE0 + kArrayUnit + static_cast<GLuint>(a));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[a].id);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader.setInt("materialMode", mode == Mode::Bindless ? 1 : 2);
+}
+
+void MaterialTable::bindMaterial(Shader& shader, std::vector<Mesh>& meshes, uint32_t material) const {
+    meshes[materials[material].mesh].bindTextures(shader);
+    // Streamed textures draw untextured until resident, as in the other modes.
+    const int diffuse = materials[material].diffuse;
+    const bool textured = diffuse >= 0 && (!slots[diffuse].source || slots[diffuse].source->resident);
+    shader.setInt("materialMode", textured ? 3 : 0);
+}
+
+void MaterialTable::release() {
+    for (Slot& slot : slots) {
+        if (slot.handle != 0) {
+            releaseHandle(slot.handle);
+            slot.handle = 0;
+        }
+        slot.ready = false;
+        slot.array = 0;
+        slot.layer = -1;
+    }
+    releaseArrays();
+    recordBuffer.release();
+}
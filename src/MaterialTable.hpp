@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <gl/glew.h>
+#include "GPUBuffer.hpp"
+#include "Mesh.hpp"
+
+// One entry of the material SSBO, read by default.frag (std430). Handles are bindless
+// texture handles, 0 without a texture; layers index materialArrays[array], -1 without one.
+struct MaterialRecord {
+    uint64_t diffuseHandle = 0;
+    uint64_t specularHandle = 0;
+    int32_t diffuseLayer = -1;
+    int32_t specularLayer = -1;
+    uint32_t diffuseArray = 0;
+    uint32_t specularArray = 0;
+};
+
+// A model's distinct texture sets, gathered once so draws pick their textures by index
+// instead of binding them. With ARB_bindless_texture every texture is exposed through a
+// resident handle. Without it, textures are copied into one 2D array per size and format
+// (ARB_copy_image) and addressed by array and layer, at the price of a second copy in
+// VRAM. With neither, draws fall back to binding each material's textures. Streamed
+// textures join the table once resident; until then their meshes draw untextured.
+class MaterialTable {
+public:
+    enum class Mode {
+        Bound,
+        Bindless,
+        Arrays
+    };
+
+    static constexpr GLuint kMaterialBinding = 9;
+    // materialArrays in default.frag occupy kMaxArrays units from kArrayUnit.
+    static constexpr GLuint kArrayUnit = 16;
+    static constexpr size_t kMaxArrays = 8;
+    // Layers an array starts with; it doubles when full, so streamed textures joining one
+    // at a time cost amortised O(1) copies each.
+    static constexpr GLsizei kInitialLayers = 4;
+
+    static const char* modeName(Mode mode);
+
+    MaterialTable() = default;
+    ~MaterialTable();
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // Gives every mesh a material; meshes with the same textures share one.
+    void build(const std::vector<Mesh>& meshes);
+    uint32_t getMaterialIndex(size_t meshIndex) const { return meshMaterials[meshIndex]; }
+    size_t getMaterialCount() const { return materials.size(); }
+    Mode getMode() const { return mode; }
+
+    // Once per frame before drawing: takes in textures that became resident, then binds
+    // the table, the arrays and the materialMode uniform. No texture binds in Bound mode.
+    void bind(Shader& shader);
+    // Bound mode only: binds the textures of material with Mesh::bindTextures and points
+    // materialMode at texture_diffuse0, or at white without a diffuse texture.
+    void bindMaterial(Shader& shader, std::vector<Mesh>& meshes, uint32_t material) const;
+    // Drops handle residency and deletes the arrays; call before the context goes away.
+    void release();
+
+private:
+    // A distinct texture, shared by every material using it.
+    struct Slot {
+        GLuint id = 0;
+        // Set for cache textures, whose resident flag says when streaming finished.
+        TextureCache::Handle source;
+        bool ready = false;
+        GLuint64 handle = 0;
+        uint32_t array = 0;
+        int32_t layer = -1;
+    };
+
+    struct Material {
+        size_t mesh = 0;
+        int diffuse = -1;
+        int specular = -1;
+    };
+
+    // Textures of one size, level count and format, layered in a 2D array with room for
+    // capacity layers.
+    struct LayerArray {
+        GLuint id = 0;
+        GLint width = 0;
+        GLint height = 0;
+        GLint levels = 0;
+        GLint format = 0;
+        std::array<GLint, 4> swizzle{};
+        GLsizei layers = 0;
+        GLsizei capacity = 0;
+    };
+
+    // Index of texture's slot, added on first use; -1 for a texture that failed to load.
+    int addSlot(const Texture& texture);
+    // Returns true when a texture became usable since the last call.
+    bool refresh();
+    // Arrays mode: copies a newly ready slot into the array of its shape.
+    void addLayer(Slot& slot);
+    // Reallocates array with capacity layers, keeping the layers already filled.
+    void growArray(LayerArray& array, GLsizei capacity);
+    void releaseArrays();
+    void upload();
+
+    Mode mode = Mode::Bound;
+    std::vector<Slot> slots;
+    std::vector<Material> materials;
+    std::vector<uint32_t> meshMaterials;
+    std::vector<LayerArray> arrays;
+    GPUBuffer recordBuffer;
+};
@@ -18,7 +18,37 @@ Menu::Menu() :
     geometryEffects(false),
     showLBVH(false),
     rebuildLBVH(false),
+    useCPULBVH(false),
+    refitLBVHOnTransform(true),
+    lbvhBuildQuality(BVHBuildQuality::Fast),
+    lbvhMortonPrecision(MortonPrecision::Bits30),
     lastLBVHBuildTime(0.0f),
+    lastLBVHRefitTime(0.0f),
+    lastLBVHCostRatio(1.0f),
+    lastLBVHSAHCost(0.0f),
+    lastLBVHDuplicateRate(0.0f),
+    lastTLASBuildTime(0.0f),
+    tlasInstanceCount(0),
+    useMeshLOD(true),
+    lodPixelError(1.0f),
+    lodDrawnTriangles(0),
+    lodFullTriangles(0),
+    useMeshletCulling(true),
+    useConeCulling(true),
+    visibleMeshlets(0),
+    totalMeshlets(0),
+    useFrustumCulling(true),
+    visibleMeshes(0),
+    culledMeshes(0),
+    indirectCommands(0),
+    indirectDrawCalls(0),
+    materialCount(0),
+    materialBinding(""),
+    textureBudgetMB(16),
+    texturesPending(0),
+    texturesResident(0),
+    textureUploadKB(0),
+    textureCacheBudgetMB(512),
     windowPtr(nullptr),
     modelPosition(0.0f, 1.15f, -8.0f),
     modelRotation(90.0f, 180.0f, 0.0f),
@@ -349,10 +379,64 @@ void Menu::renderGuizmoControls() {
         ImGui::Separator();
         ImGui::Text("LBVH Controls:");
         ImGui::Checkbox("Show LBVH (L)", &showLBVH);
+        if (ImGui::Checkbox("Build on CPU", &useCPULBVH)) {
+            rebuildLBVH = true;
+        }
+        ImGui::Checkbox("Refit on transform", &refitLBVHOnTransform);
+        ImGui::Text("Build Quality:");
+        if (ImGui::RadioButton("Fast", lbvhBuildQuality == BVHBuildQuality::Fast)) {
+            lbvhBuildQuality = BVHBuildQuality::Fast;
+            rebuildLBVH = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Treelet", lbvhBuildQuality == BVHBuildQuality::TreeletOptimized)) {
+            lbvhBuildQuality = BVHBuildQuality::TreeletOptimized;
+            rebuildLBVH = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("SAH", lbvhBuildQuality == BVHBuildQuality::BinnedSAH)) {
+            lbvhBuildQuality = BVHBuildQuality::BinnedSAH;
+            rebuildLBVH = true;
+        }
+        ImGui::Text("Morton Codes:");
+        if (ImGui::RadioButton("30-bit", lbvhMortonPrecision == MortonPrecision::Bits30)) {
+            lbvhMortonPrecision = MortonPrecision::Bits30;
+            rebuildLBVH = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("63-bit", lbvhMortonPrecision == MortonPrecision::Bits63)) {
+            lbvhMortonPrecision = MortonPrecision::Bits63;
+            rebuildLBVH = true;
+        }
         if (ImGui::Button("Rebuild LBVH")) {
             rebuildLBVH = true;
         }
-        ImGui::Text("Last LBVH Build Time: %.2f ms", lastLBVHBuildTime);
+        ImGui::Text("Last LBVH Build Time: %.2f ms (SAH cost %.1f)", lastLBVHBuildTime, lastLBVHSAHCost);
+        ImGui::Text("Duplicate Morton codes: %.2f%%", lastLBVHDuplicateRate * 100.0f);
+        ImGui::Text("Last LBVH Refit Time: %.2f ms (SAH x%.2f)", lastLBVHRefitTime, lastLBVHCostRatio);
+        ImGui::Text("TLAS: %d instances, %.3f ms", tlasInstanceCount, lastTLASBuildTime);
+        ImGui::Separator();
+        ImGui::Text("Mesh LOD:");
+        ImGui::Checkbox("Screen-space LOD", &useMeshLOD);
+        ImGui::SliderFloat("Max error (px)", &lodPixelError, 0.25f, 8.0f, "%.2f");
+        ImGui::Text("Triangles: %d / %d", lodDrawnTriangles, lodFullTriangles);
+        ImGui::Separator();
+        ImGui::Text("Culling:");
+        ImGui::Checkbox("Frustum culling", &useFrustumCulling);
+        ImGui::Text("Meshes: %d visible, %d culled", visibleMeshes, culledMeshes);
+        ImGui::Text("Indirect: %d commands in %d draw calls", indirectCommands, indirectDrawCalls);
+        ImGui::Text("Materials: %d, %s", materialCount, materialBinding);
+        ImGui::Checkbox("Meshlet culling", &useMeshletCulling);
+        ImGui::Checkbox("Cone culling", &useConeCulling);
+        ImGui::Text("Meshlets: %d / %d visible", visibleMeshlets, totalMeshlets);
+        ImGui::Separator();
+        ImGui::Text("Texture streaming:");
+        ImGui::SliderInt("Upload budget (MB/frame)", &textureBudgetMB, 1, 64);
+        ImGui::Text("Textures: %d resident, %d pending, %d KB this frame", texturesResident, texturesPending, textureUploadKB);
+        ImGui::SliderInt("Cache budget (MB)", &textureCacheBudgetMB, 64, 4096);
+        ImGui::Text("Cache: %d textures, %.1f MB, %d hits, %d misses, %d evicted",
+            static_cast<int>(textureCacheStats.entries), textureCacheStats.residentBytes / (1024.0 * 1024.0),
+            static_cast<int>(textureCacheStats.hits), static_cast<int>(textureCacheStats.misses), static_cast<int>(textureCacheStats.evictions));
     }
     ImGui::End();
 }
@@ -440,7 +524,7 @@ void Menu::renderAboutWindow() {
     ImGui::BulletText("ImGuizmo Transform Gizmos");
     ImGui::BulletText("Real-time Ocean + Volumetric Clouds");
     ImGui::BulletText("Soft Cloud-like Bunny Material");
-    ImGui::BulletText("Linear BVH Construction (GPU)");
+    ImGui::BulletText("Linear BVH Construction (GPU / parallel CPU)");
     ImGui::BulletText("Editor Mode (Press B)");
     ImGui::Separator();
     ImGui::Text("Guizmo Controls:");
@@ -13,6 +13,7 @@
 #include <string>
 
 #include "LBVH.hpp"
+#include "TextureCache.hpp"
 
 class Menu {
 public:
@@ -83,6 +84,10 @@ public:
     bool bKeyPressed;
     bool showLBVH;
     bool rebuildLBVH;
+    bool useCPULBVH;
+    bool refitLBVHOnTransform;
+    BVHBuildQuality lbvhBuildQuality;
+    MortonPrecision lbvhMortonPrecision;
     bool wireframeMode;
     bool showNormals;
     bool geometryEffects;
@@ -94,6 +99,33 @@ public:
     glm::vec3 modelScale;
     glm::mat4 modelMatrix;
     float lastLBVHBuildTime;
+    float lastLBVHRefitTime;
+    float lastLBVHCostRatio;
+    float lastLBVHSAHCost;
+    float lastLBVHDuplicateRate;
+    float lastTLASBuildTime;
+    int tlasInstanceCount;
+    bool useMeshLOD;
+    float lodPixelError;
+    int lodDrawnTriangles;
+    int lodFullTriangles;
+    bool useMeshletCulling;
+    bool useConeCulling;
+    int visibleMeshlets;
+    int totalMeshlets;
+    bool useFrustumCulling;
+    int visibleMeshes;
+    int culledMeshes;
+    int indirectCommands;
+    int indirectDrawCalls;
+    int materialCount;
+    const char* materialBinding;
+    int textureBudgetMB;
+    int texturesPending;
+    int texturesResident;
+    int textureUploadKB;
+    int textureCacheBudgetMB;
+    TextureCache::Stats textureCacheStats;
 
     ImGuizmo::OPERATION guizmoOperation;
     ImGuizmo::MODE guizmoMode;
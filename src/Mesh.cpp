@@ -1,31 +1,104 @@
 #include "Mesh.hpp"
 
-Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Texture>& textures) {
+Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Texture>& textures,
+    VertexFormat format, MeshLODChain lodChain, MeshletSet meshletSet) {
     this->vertices = std::move(vertices);
     this->indices = std::move(indices);
     this->textures = std::move(textures);
+    this->vertexFormat = format;
+    this->lodChain = std::move(lodChain);
+    this->meshletSet = std::move(meshletSet);
+    for (const Vertex& vertex : this->vertices) {
+        bounds.expand(vertex.position);
+    }
 
-    vbo = std::make_unique<VBO>(this->vertices);
-    ebo = std::make_unique<EBO>(this->indices);
+    if (vertexFormat == VertexFormat::Quantized) {
+        quantization = computeVertexQuantization(this->vertices);
+        const std::vector<PackedVertex> packed = packVertices(this->vertices, quantization);
+        vbo = std::make_unique<VBO>(packed.data(), static_cast<GLsizeiptr>(packed.size() * sizeof(PackedVertex)));
+    }
+    else {
+        vbo = std::make_unique<VBO>(this->vertices);
+    }
+    if (this->lodChain.indices.empty() && this->meshletSet.indices.empty()) {
+        ebo = std::make_unique<EBO>(this->indices);
+    }
+    else {
+        std::vector<GLuint> allIndices;
+        allIndices.reserve(this->indices.size() + this->lodChain.indices.size() + this->meshletSet.indices.size());
+        allIndices.insert(allIndices.end(), this->indices.begin(), this->indices.end());
+        allIndices.insert(allIndices.end(), this->lodChain.indices.begin(), this->lodChain.indices.end());
+        allIndices.insert(allIndices.end(), this->meshletSet.indices.begin(), this->meshletSet.indices.end());
+        ebo = std::make_unique<EBO>(allIndices);
+    }
 
     vao.Bind();
     vbo->Bind();
     ebo->Bind();
 
-    vao.linkAttrib(*vbo, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    vao.linkAttrib(*vbo, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    vao.linkAttrib(*vbo, 2, 2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    vao.linkAttrib(*vbo, 3, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-    vao.linkAttrib(*vbo, 4, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    linkVertexAttributes(vao, *vbo, vertexFormat);
 
     vao.UnBind();
     vbo->UnBind();
     ebo->UnBind();
 }
 
-void Mesh::Draw(Shader& shader, Camera& camera) {
-    vao.Bind();
+void Mesh::linkVertexAttributes(const VAO& vao, const VBO& vbo, VertexFormat format) {
+    if (format == VertexFormat::Quantized) {
+        vao.linkAttrib(vbo, 0, 4, GL_UNSIGNED_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position), GL_TRUE);
+        vao.linkAttrib(vbo, 1, 4, GL_INT_2_10_10_10_REV, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal), GL_TRUE);
+        vao.linkAttrib(vbo, 2, 2, GL_HALF_FLOAT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+    }
+    else {
+        vao.linkAttrib(vbo, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        vao.linkAttrib(vbo, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        vao.linkAttrib(vbo, 2, 2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+        vao.linkAttrib(vbo, 3, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+        vao.linkAttrib(vbo, 4, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    }
+}
 
+size_t Mesh::getVertexStride() const {
+    return vertexFormat == VertexFormat::Quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+void Mesh::releaseBuffers() {
+    vbo.reset();
+    ebo.reset();
+    vao.release();
+}
+
+IndexRange Mesh::getLODRange(size_t lod) const {
+    if (lod == 0 || lod >= getLODCount()) {
+        return { 0, static_cast<uint32_t>(indices.size()) };
+    }
+    const MeshLOD& level = lodChain.levels[lod - 1];
+    return { static_cast<uint32_t>(indices.size()) + level.firstIndex, level.indexCount };
+}
+
+void Mesh::appendMeshletRanges(std::span<const uint32_t> visibleMeshlets, std::vector<IndexRange>& ranges) const {
+    const uint32_t meshletBase = static_cast<uint32_t>(indices.size() + lodChain.indices.size());
+    const size_t firstRange = ranges.size();
+    for (uint32_t m : visibleMeshlets) {
+        const Meshlet& meshlet = meshletSet.meshlets[m];
+        const uint32_t first = meshletBase + meshlet.firstIndex;
+        if (ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().count == first) {
+            ranges.back().count += meshlet.indexCount;
+            continue;
+        }
+        ranges.push_back({ first, meshlet.indexCount });
+    }
+}
+
+void Mesh::setVertexFormatUniforms(Shader& shader) const {
+    // Float meshes use the identity transform, so default.vert decodes both layouts.
+    shader.setBool("indirectDraw", false);
+    shader.setBool("quantizedVertices", vertexFormat == VertexFormat::Quantized);
+    shader.setVec3("positionOffset", quantization.offset);
+    shader.setVec3("positionScale", quantization.scale);
+}
+
+void Mesh::bindTextures(Shader& shader) {
     unsigned int numDiffuse = 0;
     unsigned int numSpecular = 0;
     unsigned int numNormal = 0;
@@ -34,6 +107,11 @@ void Mesh::Draw(Shader& shader, Camera& camera) {
     for (unsigned int i = 0; i < textures.size(); i++) {
         std::string num;
         std::string type = textures[i].type_r;
+        // Model textures are typed "diffuse", older loaders use "texture_diffuse"; both
+        // bind to texture_diffuse0 and so on.
+        if (type.rfind("texture_", 0) != 0) {
+            type = "texture_" + type;
+        }
 
         if (type == "texture_diffuse") {
             num = std::to_string(numDiffuse++);
@@ -54,8 +132,37 @@ void Mesh::Draw(Shader& shader, Camera& camera) {
         std::string uniformName = type + num;
         shader.setInt(uniformName, i);
     }
+}
+
+void Mesh::Draw(Shader& shader, Camera& camera, size_t lod) {
+    if (!hasBuffers()) {
+        return;
+    }
+    vao.Bind();
+    setVertexFormatUniforms(shader);
 
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+    const IndexRange range = getLODRange(lod);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.count), GL_UNSIGNED_INT, (void*)(range.firstIndex * sizeof(GLuint)));
 
+    vao.UnBind();
+}
+
+void Mesh::DrawMeshlets(Shader& shader, Camera& camera, std::span<const uint32_t> visibleMeshlets) {
+    if (visibleMeshlets.empty() || !hasBuffers()) {
+        return;
+    }
+
+    std::vector<IndexRange> ranges;
+    appendMeshletRanges(visibleMeshlets, ranges);
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    for (const IndexRange& range : ranges) {
+        counts.push_back(static_cast<GLsizei>(range.count));
+        offsets.push_back((void*)(range.firstIndex * sizeof(GLuint)));
+    }
+
+    vao.Bind();
+    setVertexFormatUniforms(shader);
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(counts.size()));
     vao.UnBind();
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <gl/glew.h>
@@ -8,6 +9,10 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include "Vertex.hpp"    
+#include "PackedVertex.hpp"
+#include "MeshSimplifier.hpp"
+#include "Meshlet.hpp"
+#include "LBVH.hpp"
 #include "VAO.hpp"
 #include "VBO.hpp"
 #include "EBO.hpp"
@@ -15,6 +20,12 @@
 #include "Texture.hpp"
 #include "Shader.hpp"
 
+// A range of a mesh's element buffer, counted in indices from the start of its EBO.
+struct IndexRange {
+    uint32_t firstIndex = 0;
+    uint32_t count = 0;
+};
+
 class Mesh {
 public:
     std::vector<Vertex> vertices;
@@ -23,12 +34,53 @@ public:
     VAO vao;
     std::unique_ptr<VBO> vbo;
     std::unique_ptr<EBO> ebo;
+    // vertices always holds the float data; format only selects what the VBO stores.
+    VertexFormat vertexFormat = VertexFormat::Float;
+    VertexQuantization quantization;
+    // Simplified levels; the EBO holds indices, then lodChain.indices, then meshletSet.indices.
+    MeshLODChain lodChain;
+    // Level 0 regrouped into clusters for culling; empty when meshlets were not built.
+    MeshletSet meshletSet;
+    // Mesh-local bounds of vertices, computed on construction.
+    AABB bounds;
 
 public:
-    Mesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Texture>& textures);
+    Mesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Texture>& textures,
+        VertexFormat format = VertexFormat::Float, MeshLODChain lodChain = {}, MeshletSet meshletSet = {});
+
+    // Level 0 is the full mesh with zero error.
+    size_t getLODCount() const { return lodChain.levels.size() + 1; }
+    float getLODError(size_t lod) const { return lod == 0 ? 0.0f : lodChain.levels[lod - 1].error; }
+    size_t getLODIndexCount(size_t lod) const { return lod == 0 ? indices.size() : lodChain.levels[lod - 1].indexCount; }
+
+    IndexRange getLODRange(size_t lod) const;
+
+    bool hasMeshlets() const { return !meshletSet.meshlets.empty(); }
+    const std::vector<Meshlet>& getMeshlets() const { return meshletSet.meshlets; }
+    // Appends the listed meshlets (ascending indices into getMeshlets()) as EBO ranges,
+    // merging meshlets that are consecutive in the buffer.
+    void appendMeshletRanges(std::span<const uint32_t> visibleMeshlets, std::vector<IndexRange>& ranges) const;
 
-    void Draw(Shader& shader, Camera& camera);  
+    // Layout of the GPU buffers, for packing several meshes into one (DrawBatch).
+    size_t getVertexStride() const;
+    size_t getBufferIndexCount() const { return indices.size() + lodChain.indices.size() + meshletSet.indices.size(); }
+    static void linkVertexAttributes(const VAO& vao, const VBO& vbo, VertexFormat format);
+    // Frees the VAO, VBO and EBO once their contents live in a shared batch; Draw is a
+    // no-op afterwards. CPU-side data is kept.
+    void releaseBuffers();
+    bool hasBuffers() const { return ebo != nullptr; }
 
+    // Binds textures to units 0..n as texture_diffuse0, texture_specular0 and so on, for
+    // MaterialTable's Bound mode. Draw and DrawMeshlets leave texture state to the caller.
+    void bindTextures(Shader& shader);
+    void Draw(Shader& shader, Camera& camera, size_t lod = 0);
+    // Draws the listed meshlets at full detail with a single glMultiDrawElements.
+    void DrawMeshlets(Shader& shader, Camera& camera, std::span<const uint32_t> visibleMeshlets);
+
+private:
+    void setVertexFormatUniforms(Shader& shader) const;
+
+public:
     Mesh(const Mesh&) = delete;
     Mesh& operator=(const Mesh&) = delete;
 
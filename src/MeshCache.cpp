@@ -0,0 +1,397 @@
+#include "MeshCache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    constexpr char kMagic[8] = { 'E', 'D', 'M', 'C', 'A', 'C', 'H', 'E' };
+    constexpr uint64_t kPageSize = 4096;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t nodeStride;
+        uint32_t meshCount;
+        uint32_t textureCount;
+        uint32_t flags;
+        uint64_t sourceSize;
+        int64_t sourceModifiedTime;
+        uint64_t sourceHash;
+        uint64_t meshTableOffset;
+        uint64_t textureTableOffset;
+        uint64_t dependencyTableOffset;
+        uint32_t dependencyCount;
+        uint32_t reserved;
+        uint64_t fileSize;
+    };
+
+    // Followed by pathLength bytes of path, relative to the source's directory.
+    struct DependencyRecord {
+        uint64_t size;
+        int64_t modifiedTime;
+        uint32_t pathLength;
+    };
+
+    struct MeshRecord {
+        uint64_t vertexOffset, vertexCount;
+        uint64_t indexOffset, indexCount;
+        uint64_t nodeOffset, nodeCount;
+        uint64_t lodIndexOffset, lodIndexCount;
+        uint64_t lodOffset, lodCount;
+        uint64_t meshletIndexOffset, meshletIndexCount;
+        uint64_t meshletOffset, meshletCount;
+        float boundsMin[3], boundsMax[3];
+        float matrix[16];
+        float translation[3];
+        float rotation[4]; // x, y, z, w
+        float scale[3];
+    };
+
+    uint64_t alignToPage(uint64_t offset) {
+        return (offset + kPageSize - 1) & ~(kPageSize - 1);
+    }
+
+    template<typename T>
+    bool sectionInRange(uint64_t offset, uint64_t count, uint64_t fileSize) {
+        return offset % alignof(T) == 0 && offset <= fileSize && count <= (fileSize - offset) / sizeof(T);
+    }
+
+    void writePadding(std::ofstream& out, uint64_t& position, uint64_t target) {
+        static const char zeros[kPageSize] = {};
+        while (position < target) {
+            const uint64_t chunk = std::min<uint64_t>(target - position, kPageSize);
+            out.write(zeros, static_cast<std::streamsize>(chunk));
+            position += chunk;
+        }
+    }
+}
+
+std::string MeshCache::pathFor(const std::string& sourcePath) {
+    return std::filesystem::path(sourcePath).replace_extension(".meshcache").string();
+}
+
+bool MeshCache::describeSource(const std::string& sourcePath, MeshCacheSourceKey& key, bool withHash) {
+    std::error_code error;
+    key.size = std::filesystem::file_size(sourcePath, error);
+    if (error) {
+        return false;
+    }
+    key.modifiedTime = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    if (error) {
+        return false;
+    }
+
+    key.contentHash = 0;
+    if (withHash) {
+        MappedFile source(sourcePath);
+        if (!source.isOpen()) {
+            return false;
+        }
+        key.contentHash = hashBytes(source.bytes());
+    }
+    return true;
+}
+
+bool MeshCache::write(const std::string& sourcePath, const std::vector<MeshCacheMesh>& meshes, const std::vector<MeshCacheTexture>& textures,
+    uint32_t flags, const std::vector<std::string>& dependencies) {
+    MeshCacheSourceKey key;
+    if (!describeSource(sourcePath, key, true)) {
+        MyglobalLogger().logMessage(Logger::WARNING, "Cannot describe " + sourcePath + " for the mesh cache", __FILE__, __LINE__);
+        return false;
+    }
+
+    const std::filesystem::path sourceDirectory = std::filesystem::path(sourcePath).parent_path();
+    std::vector<char> dependencyTable;
+    for (const std::string& dependency : dependencies) {
+        MeshCacheSourceKey dependencyKey;
+        if (!describeSource((sourceDirectory / dependency).string(), dependencyKey, false)) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Cannot describe " + dependency + " for the mesh cache", __FILE__, __LINE__);
+            return false;
+        }
+        const DependencyRecord record{ dependencyKey.size, dependencyKey.modifiedTime, static_cast<uint32_t>(dependency.size()) };
+        dependencyTable.insert(dependencyTable.end(), reinterpret_cast<const char*>(&record), reinterpret_cast<const char*>(&record) + sizeof(record));
+        dependencyTable.insert(dependencyTable.end(), dependency.begin(), dependency.end());
+    }
+
+    // Lay out: header page, mesh table, texture table, dependency table, then one
+    // page-aligned run per array.
+    CacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.vertexStride = sizeof(Vertex);
+    header.nodeStride = sizeof(LBVHNode);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.textureCount = static_cast<uint32_t>(textures.size());
+    header.flags = flags;
+    header.sourceSize = key.size;
+    header.sourceModifiedTime = key.modifiedTime;
+    header.sourceHash = key.contentHash;
+    header.meshTableOffset = kPageSize;
+
+    std::vector<char> textureTable;
+    for (const auto& texture : textures) {
+        const uint32_t lengths[2] = { static_cast<uint32_t>(texture.uri.size()), static_cast<uint32_t>(texture.type.size()) };
+        textureTable.insert(textureTable.end(), reinterpret_cast<const char*>(lengths), reinterpret_cast<const char*>(lengths) + sizeof(lengths));
+        textureTable.insert(textureTable.end(), texture.uri.begin(), texture.uri.end());
+        textureTable.insert(textureTable.end(), texture.type.begin(), texture.type.end());
+    }
+    header.textureTableOffset = header.meshTableOffset + meshes.size() * sizeof(MeshRecord);
+    header.dependencyTableOffset = header.textureTableOffset + textureTable.size();
+    header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+
+    std::vector<MeshRecord> records(meshes.size());
+    uint64_t offset = alignToPage(header.dependencyTableOffset + dependencyTable.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshCacheMesh& mesh = meshes[i];
+        MeshRecord& record = records[i];
+        record.vertexOffset = offset;
+        record.vertexCount = mesh.vertices.size();
+        offset = alignToPage(offset + mesh.vertices.size_bytes());
+        record.indexOffset = offset;
+        record.indexCount = mesh.indices.size();
+        offset = alignToPage(offset + mesh.indices.size_bytes());
+        record.nodeOffset = offset;
+        record.nodeCount = mesh.bvhNodes.size();
+        offset = alignToPage(offset + mesh.bvhNodes.size_bytes());
+        record.lodIndexOffset = offset;
+        record.lodIndexCount = mesh.lodIndices.size();
+        offset = alignToPage(offset + mesh.lodIndices.size_bytes());
+        record.lodOffset = offset;
+        record.lodCount = mesh.lods.size();
+        offset = alignToPage(offset + mesh.lods.size_bytes());
+        record.meshletIndexOffset = offset;
+        record.meshletIndexCount = mesh.meshletIndices.size();
+        offset = alignToPage(offset + mesh.meshletIndices.size_bytes());
+        record.meshletOffset = offset;
+        record.meshletCount = mesh.meshlets.size();
+        offset = alignToPage(offset + mesh.meshlets.size_bytes());
+
+        for (int axis = 0; axis < 3; ++axis) {
+            record.boundsMin[axis] = mesh.bounds.min[axis];
+            record.boundsMax[axis] = mesh.bounds.max[axis];
+            record.translation[axis] = mesh.translation[axis];
+            record.scale[axis] = mesh.scale[axis];
+        }
+        record.rotation[0] = mesh.rotation.x;
+        record.rotation[1] = mesh.rotation.y;
+        record.rotation[2] = mesh.rotation.z;
+        record.rotation[3] = mesh.rotation.w;
+        std::memcpy(record.matrix, &mesh.matrix[0][0], sizeof(record.matrix));
+    }
+    header.fileSize = offset;
+
+    // Written under a temporary name and renamed, so a reader never maps a partial file.
+    const std::string cachePath = pathFor(sourcePath);
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Cannot write mesh cache " + tempPath, __FILE__, __LINE__);
+            return false;
+        }
+
+        uint64_t position = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        position += sizeof(header);
+        writePadding(out, position, header.meshTableOffset);
+        out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(MeshRecord)));
+        out.write(textureTable.data(), static_cast<std::streamsize>(textureTable.size()));
+        out.write(dependencyTable.data(), static_cast<std::streamsize>(dependencyTable.size()));
+        position = header.dependencyTableOffset + dependencyTable.size();
+
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            writePadding(out, position, records[i].vertexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].vertices.data()), static_cast<std::streamsize>(meshes[i].vertices.size_bytes()));
+            position += meshes[i].vertices.size_bytes();
+            writePadding(out, position, records[i].indexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].indices.data()), static_cast<std::streamsize>(meshes[i].indices.size_bytes()));
+            position += meshes[i].indices.size_bytes();
+            writePadding(out, position, records[i].nodeOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].bvhNodes.data()), static_cast<std::streamsize>(meshes[i].bvhNodes.size_bytes()));
+            position += meshes[i].bvhNodes.size_bytes();
+            writePadding(out, position, records[i].lodIndexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].lodIndices.data()), static_cast<std::streamsize>(meshes[i].lodIndices.size_bytes()));
+            position += meshes[i].lodIndices.size_bytes();
+            writePadding(out, position, records[i].lodOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].lods.data()), static_cast<std::streamsize>(meshes[i].lods.size_bytes()));
+            position += meshes[i].lods.size_bytes();
+            writePadding(out, position, records[i].meshletIndexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].meshletIndices.data()), static_cast<std::streamsize>(meshes[i].meshletIndices.size_bytes()));
+            position += meshes[i].meshletIndices.size_bytes();
+            writePadding(out, position, records[i].meshletOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].meshlets.data()), static_cast<std::streamsize>(meshes[i].meshlets.size_bytes()));
+            position += meshes[i].meshlets.size_bytes();
+        }
+        writePadding(out, position, header.fileSize);
+
+        if (!out) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Failed while writing mesh cache " + tempPath, __FILE__, __LINE__);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        MyglobalLogger().logMessage(Logger::WARNING, "Cannot replace mesh cache " + cachePath, __FILE__, __LINE__);
+        return false;
+    }
+
+    MyglobalLogger().logMessage(Logger::INFO, "Wrote mesh cache " + cachePath + " (" + std::to_string(header.fileSize) + " bytes)", __FILE__, __LINE__);
+    return true;
+}
+
+bool MeshCache::open(const std::string& sourcePath) {
+    meshes.clear();
+    textures.clear();
+    dependencies.clear();
+    flags = 0;
+    file.close();
+
+    const std::string cachePath = pathFor(sourcePath);
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error)) {
+        return false;
+    }
+
+    MeshCacheSourceKey key;
+    if (!describeSource(sourcePath, key, false) || !file.open(cachePath)) {
+        return false;
+    }
+
+    CacheHeader header;
+    const std::span<const unsigned char> bytes = file.bytes();
+    if (bytes.size() < sizeof(header)) {
+        file.close();
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.vertexStride != sizeof(Vertex) || header.nodeStride != sizeof(LBVHNode) || header.fileSize != bytes.size()) {
+        MyglobalLogger().logMessage(Logger::INFO, "Mesh cache " + cachePath + " has an incompatible format", __FILE__, __LINE__);
+        file.close();
+        return false;
+    }
+
+    bool sourceMatches = header.sourceSize == key.size && header.sourceModifiedTime == key.modifiedTime;
+    if (!sourceMatches && header.sourceSize == key.size) {
+        describeSource(sourcePath, key, true);
+        sourceMatches = header.sourceHash == key.contentHash;
+    }
+    if (!sourceMatches) {
+        MyglobalLogger().logMessage(Logger::INFO, "Mesh cache " + cachePath + " is stale", __FILE__, __LINE__);
+        file.close();
+        return false;
+    }
+
+    // External buffers can change under an untouched .gltf; any difference is stale.
+    const std::filesystem::path sourceDirectory = std::filesystem::path(sourcePath).parent_path();
+    uint64_t dependencyOffset = header.dependencyTableOffset;
+    for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+        DependencyRecord record;
+        if (dependencyOffset > bytes.size() || bytes.size() - dependencyOffset < sizeof(record)) {
+            file.close();
+            return false;
+        }
+        std::memcpy(&record, bytes.data() + dependencyOffset, sizeof(record));
+        dependencyOffset += sizeof(record);
+        if (bytes.size() - dependencyOffset < record.pathLength) {
+            file.close();
+            return false;
+        }
+        const std::string dependency(reinterpret_cast<const char*>(bytes.data() + dependencyOffset), record.pathLength);
+        dependencyOffset += record.pathLength;
+
+        MeshCacheSourceKey dependencyKey;
+        if (!describeSource((sourceDirectory / dependency).string(), dependencyKey, false) ||
+            dependencyKey.size != record.size || dependencyKey.modifiedTime != record.modifiedTime) {
+            MyglobalLogger().logMessage(Logger::INFO, "Mesh cache " + cachePath + " is stale: " + dependency + " changed", __FILE__, __LINE__);
+            dependencies.clear();
+            file.close();
+            return false;
+        }
+        dependencies.push_back(dependency);
+    }
+
+    if (!sectionInRange<MeshRecord>(header.meshTableOffset, header.meshCount, bytes.size())) {
+        file.close();
+        return false;
+    }
+
+    const MeshRecord* records = reinterpret_cast<const MeshRecord*>(bytes.data() + header.meshTableOffset);
+    meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        const MeshRecord& record = records[i];
+        if (!sectionInRange<Vertex>(record.vertexOffset, record.vertexCount, bytes.size()) ||
+            !sectionInRange<uint32_t>(record.indexOffset, record.indexCount, bytes.size()) ||
+            !sectionInRange<LBVHNode>(record.nodeOffset, record.nodeCount, bytes.size()) ||
+            !sectionInRange<uint32_t>(record.lodIndexOffset, record.lodIndexCount, bytes.size()) ||
+            !sectionInRange<MeshLOD>(record.lodOffset, record.lodCount, bytes.size()) ||
+            !sectionInRange<uint32_t>(record.meshletIndexOffset, record.meshletIndexCount, bytes.size()) ||
+            !sectionInRange<Meshlet>(record.meshletOffset, record.meshletCount, bytes.size())) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Mesh cache " + cachePath + " is corrupt", __FILE__, __LINE__);
+            meshes.clear();
+            file.close();
+            return false;
+        }
+
+        MeshCacheMesh& mesh = meshes[i];
+        mesh.vertices = { reinterpret_cast<const Vertex*>(bytes.data() + record.vertexOffset), record.vertexCount };
+        mesh.indices = { reinterpret_cast<const uint32_t*>(bytes.data() + record.indexOffset), record.indexCount };
+        mesh.bvhNodes = { reinterpret_cast<const LBVHNode*>(bytes.data() + record.nodeOffset), record.nodeCount };
+        mesh.lodIndices = { reinterpret_cast<const uint32_t*>(bytes.data() + record.lodIndexOffset), record.lodIndexCount };
+        mesh.lods = { reinterpret_cast<const MeshLOD*>(bytes.data() + record.lodOffset), record.lodCount };
+        for (const MeshLOD& lod : mesh.lods) {
+            if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > record.lodIndexCount) {
+                MyglobalLogger().logMessage(Logger::WARNING, "Mesh cache " + cachePath + " has an invalid LOD range", __FILE__, __LINE__);
+                meshes.clear();
+                file.close();
+                return false;
+            }
+        }
+        mesh.meshletIndices = { reinterpret_cast<const uint32_t*>(bytes.data() + record.meshletIndexOffset), record.meshletIndexCount };
+        mesh.meshlets = { reinterpret_cast<const Meshlet*>(bytes.data() + record.meshletOffset), record.meshletCount };
+        for (const Meshlet& meshlet : mesh.meshlets) {
+            if (static_cast<uint64_t>(meshlet.firstIndex) + meshlet.indexCount > record.meshletIndexCount) {
+                MyglobalLogger().logMessage(Logger::WARNING, "Mesh cache " + cachePath + " has an invalid meshlet range", __FILE__, __LINE__);
+                meshes.clear();
+                file.close();
+                return false;
+            }
+        }
+        mesh.bounds.min = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+        mesh.bounds.max = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+        std::memcpy(&mesh.matrix[0][0], record.matrix, sizeof(record.matrix));
+        mesh.translation = glm::vec3(record.translation[0], record.translation[1], record.translation[2]);
+        mesh.rotation = glm::quat(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]);
+        mesh.scale = glm::vec3(record.scale[0], record.scale[1], record.scale[2]);
+    }
+
+    flags = header.flags;
+    uint64_t offset = header.textureTableOffset;
+    for (uint32_t i = 0; i < header.textureCount; ++i) {
+        uint32_t lengths[2];
+        if (offset + sizeof(lengths) > bytes.size()) {
+            meshes.clear();
+            file.close();
+            return false;
+        }
+        std::memcpy(lengths, bytes.data() + offset, sizeof(lengths));
+        offset += sizeof(lengths);
+        if (offset + lengths[0] + lengths[1] > bytes.size()) {
+            meshes.clear();
+            file.close();
+            return false;
+        }
+        const char* text = reinterpret_cast<const char*>(bytes.data() + offset);
+        textures.push_back({ std::string(text, lengths[0]), std::string(text + lengths[0], lengths[1]) });
+        offset += lengths[0] + lengths[1];
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "LBVH.hpp"
+#include "MappedFile.hpp"
+#include "MeshSimplifier.hpp"
+#include "Meshlet.hpp"
+#include "Vertex.hpp"
+
+// Identity of the file a cache was built from. Size and mtime are the fast check; the
+// content hash decides when only the mtime differs (copies, checkouts, touch).
+struct MeshCacheSourceKey {
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t contentHash = 0;
+};
+
+// One cached mesh. The spans point into the cache mapping when read and into the
+// caller's data when written.
+struct MeshCacheMesh {
+    std::span<const Vertex> vertices;
+    std::span<const uint32_t> indices;
+    std::span<const LBVHNode> bvhNodes;
+    // MeshLODChain in cache form; empty when the model was imported without LODs.
+    std::span<const uint32_t> lodIndices;
+    std::span<const MeshLOD> lods;
+    // MeshletSet in cache form; empty when the model was imported without meshlets.
+    std::span<const uint32_t> meshletIndices;
+    std::span<const Meshlet> meshlets;
+    AABB bounds;
+    glm::mat4 matrix = glm::mat4(1.0f);
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+struct MeshCacheTexture {
+    std::string uri;
+    std::string type;
+};
+
+// Versioned binary snapshot of an imported model, stored as <source>.meshcache. Every
+// section starts on a page boundary, so vertex and index data are handed out as spans
+// straight from the read-only mapping.
+class MeshCache {
+public:
+    static constexpr uint32_t kVersion = 4;
+    // Header flags. Optimized: index and vertex order went through MeshOptimizer.
+    // LODs: every mesh carries its simplified levels. Meshlets: every mesh carries its clusters.
+    static constexpr uint32_t kFlagOptimized = 1u << 0;
+    static constexpr uint32_t kFlagLODs = 1u << 1;
+    static constexpr uint32_t kFlagMeshlets = 1u << 2;
+
+    static std::string pathFor(const std::string& sourcePath);
+    static bool describeSource(const std::string& sourcePath, MeshCacheSourceKey& key, bool withHash);
+    // dependencies are external files the import read, such as .bin buffers, relative to
+    // sourcePath's directory; their size and mtime are recorded alongside the source's.
+    static bool write(const std::string& sourcePath, const std::vector<MeshCacheMesh>& meshes, const std::vector<MeshCacheTexture>& textures,
+        uint32_t flags = 0, const std::vector<std::string>& dependencies = {});
+
+    // Maps the cache next to sourcePath and validates it against the source and its
+    // dependencies. On false the cache is missing or stale and the caller should import
+    // the source.
+    bool open(const std::string& sourcePath);
+
+    const std::vector<MeshCacheMesh>& getMeshes() const { return meshes; }
+    const std::vector<MeshCacheTexture>& getTextures() const { return textures; }
+    // The dependencies recorded by write, for rewriting the cache without losing them.
+    const std::vector<std::string>& getDependencies() const { return dependencies; }
+    uint32_t getFlags() const { return flags; }
+
+private:
+    MappedFile file;
+    std::vector<MeshCacheMesh> meshes;
+    std::vector<MeshCacheTexture> textures;
+    std::vector<std::string> dependencies;
+    uint32_t flags = 0;
+};
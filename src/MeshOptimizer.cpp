@@ -0,0 +1,333 @@
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <glm/glm.hpp>
+
+namespace {
+    // FIFO cache with timestamps: a vertex is resident while fewer than cacheSize misses
+    // happened since it was loaded. Returns the misses of one triangle.
+    struct CacheSimulator {
+        std::vector<uint32_t> loadedAt;
+        uint32_t timestamp;
+        unsigned int cacheSize;
+
+        CacheSimulator(size_t vertexCount, unsigned int size)
+            : loadedAt(vertexCount, 0), timestamp(size + 1), cacheSize(size) {
+        }
+
+        unsigned int access(uint32_t vertex) {
+            if (timestamp - loadedAt[vertex] > cacheSize) {
+                loadedAt[vertex] = timestamp++;
+                return 1;
+            }
+            return 0;
+        }
+
+        unsigned int accessTriangle(const uint32_t* triangle) {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        void flush() {
+            timestamp += cacheSize + 1;
+        }
+    };
+
+    struct TriangleAdjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    TriangleAdjacency buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount) {
+        TriangleAdjacency adjacency;
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : indices) {
+            adjacency.offsets[index + 1]++;
+        }
+        std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+        adjacency.triangles.resize(indices.size());
+        std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        return adjacency;
+    }
+
+    void applyTriangleOrder(std::vector<uint32_t>& indices, std::vector<uint32_t>& triangleOrder, const std::vector<uint32_t>& order) {
+        std::vector<uint32_t> reordered(indices.size());
+        std::vector<uint32_t> composed(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            reordered[i * 3 + 0] = indices[order[i] * 3 + 0];
+            reordered[i * 3 + 1] = indices[order[i] * 3 + 1];
+            reordered[i * 3 + 2] = indices[order[i] * 3 + 2];
+            composed[i] = triangleOrder.empty() ? order[i] : triangleOrder[order[i]];
+        }
+        indices.swap(reordered);
+        triangleOrder.swap(composed);
+    }
+
+    // Hard boundaries: triangles whose three vertices all miss start a disjoint patch.
+    // Soft boundaries: inside a patch, a new cluster starts as soon as the running ACMR
+    // is within threshold of the patch's own, so sorting clusters costs little locality.
+    std::vector<uint32_t> buildClusters(const std::vector<uint32_t>& indices, size_t vertexCount, float threshold, unsigned int cacheSize) {
+        const size_t triangleCount = indices.size() / 3;
+        CacheSimulator cache(vertexCount, cacheSize);
+
+        std::vector<uint32_t> hard;
+        for (size_t i = 0; i < triangleCount; ++i) {
+            if (cache.accessTriangle(&indices[i * 3]) == 3 || i == 0) {
+                hard.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        hard.push_back(static_cast<uint32_t>(triangleCount));
+
+        std::vector<uint32_t> clusters;
+        for (size_t h = 0; h + 1 < hard.size(); ++h) {
+            const uint32_t begin = hard[h];
+            const uint32_t end = hard[h + 1];
+
+            cache.flush();
+            unsigned int patchMisses = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                patchMisses += cache.accessTriangle(&indices[i * 3]);
+            }
+            const float patchThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+
+            clusters.push_back(begin);
+            cache.flush();
+            unsigned int runningMisses = 0;
+            unsigned int runningTriangles = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                runningMisses += cache.accessTriangle(&indices[i * 3]);
+                runningTriangles++;
+                if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= patchThreshold && i + 1 < end) {
+                    clusters.push_back(i + 1);
+                    cache.flush();
+                    runningMisses = 0;
+                    runningTriangles = 0;
+                }
+            }
+        }
+        clusters.push_back(static_cast<uint32_t>(triangleCount));
+        return clusters;
+    }
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    CacheSimulator cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (uint32_t index : indices) {
+        misses += cache.access(index);
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& triangleOrder, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    const TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    uint32_t timestamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Next vertex to fan around once the candidates are exhausted: the most recently
+    // touched vertex that still has triangles, else the next one in input order.
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnds.empty()) {
+            const uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertexCount; ++cursor) {
+            if (liveTriangles[cursor] > 0) {
+                return static_cast<int64_t>(cursor);
+            }
+        }
+        return -1;
+    };
+
+    int64_t fanning = skipDeadEnd();
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            const uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            order.push_back(triangle);
+
+            for (int corner = 0; corner < 3; ++corner) {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (timestamp - loadedAt[vertex] > cacheSize) {
+                    loadedAt[vertex] = timestamp++;
+                }
+            }
+        }
+
+        // Prefer the candidate that stays in the cache longest after emitting all of its
+        // remaining triangles; candidates that would fall out score zero.
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            const int64_t age = static_cast<int64_t>(timestamp - loadedAt[vertex]);
+            if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= static_cast<int64_t>(cacheSize)) {
+                priority = age;
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = vertex;
+            }
+        }
+        fanning = best >= 0 ? best : skipDeadEnd();
+    }
+
+    applyTriangleOrder(indices, triangleOrder, order);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::vector<uint32_t>& triangleOrder,
+    float threshold, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    const std::vector<uint32_t> clusters = buildClusters(indices, vertices.size(), threshold, cacheSize);
+    const size_t clusterCount = clusters.size() - 1;
+    if (clusterCount < 2) {
+        return;
+    }
+
+    glm::vec3 meshCentroid(0.0f);
+    for (uint32_t index : indices) {
+        meshCentroid += vertices[index].position;
+    }
+    meshCentroid /= static_cast<float>(indices.size());
+
+    // Clusters facing away from the mesh centre are likely to occlude the rest, so they
+    // are drawn first: key = dot(clusterCentroid - meshCentroid, clusterNormal).
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 scaledNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(scaledNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += scaledNormal;
+            area += triangleArea;
+        }
+        const float normalLength = glm::length(normal);
+        if (area <= 0.0f || normalLength <= 0.0f) {
+            sortKeys[c] = 0.0f;
+            continue;
+        }
+        sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    for (uint32_t cluster : clusterOrder) {
+        for (uint32_t t = clusters[cluster]; t < clusters[cluster + 1]; ++t) {
+            order.push_back(t);
+        }
+    }
+    applyTriangleOrder(indices, triangleOrder, order);
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), kDroppedVertex);
+    uint32_t nextVertex = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == kDroppedVertex) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<Vertex> reordered(nextVertex);
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        if (remap[v] != kDroppedVertex) {
+            reordered[remap[v]] = vertices[v];
+        }
+    }
+    vertices.swap(reordered);
+    return remap;
+}
+
+MeshOptimizationResult MeshOptimizer::optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    MeshOptimizationResult result;
+    if (indices.size() < 3 || indices.size() % 3 != 0 ||
+        std::any_of(indices.begin(), indices.end(), [&](uint32_t index) { return index >= vertices.size(); })) {
+        return result;
+    }
+
+    result.before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> triangleOrder;
+    optimizeVertexCache(indices, vertices.size(), triangleOrder);
+    optimizeOverdraw(indices, vertices, triangleOrder);
+    result.vertexRemap = optimizeVertexFetch(vertices, indices);
+
+    result.after = analyzeVertexCache(indices, vertices.size());
+    result.triangleRemap.resize(triangleOrder.size());
+    for (size_t i = 0; i < triangleOrder.size(); ++i) {
+        result.triangleRemap[triangleOrder[i]] = static_cast<uint32_t>(i);
+    }
+    result.optimized = true;
+    return result;
+}
+
+std::string MeshOptimizer::describe(const MeshOptimizationResult& result, size_t triangleCount) {
+    char text[160];
+    std::snprintf(text, sizeof(text), "%zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+        triangleCount, result.before.acmr, result.after.acmr, result.before.atvr, result.after.atvr);
+    return text;
+}
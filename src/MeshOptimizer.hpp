@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "Vertex.hpp"
+
+// Post-transform cache behaviour of an index buffer, simulated with a FIFO cache.
+// ACMR is vertex shader runs per triangle (3 is the worst, ~0.5 the limit for large
+// regular meshes); ATVR is runs per referenced vertex (1 is ideal).
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationResult {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    // triangleRemap[oldTriangle] = newTriangle, for data keyed by triangle index such as
+    // the leaves of a BVH built before the reorder.
+    std::vector<uint32_t> triangleRemap;
+    // vertexRemap[oldVertex] = newVertex, or kDroppedVertex if it was unreferenced.
+    std::vector<uint32_t> vertexRemap;
+    bool optimized = false;
+};
+
+// Import-time reordering of triangle meshes, applied in three passes:
+//  1. Tipsify (Sander, Nehab, Barczak 2007) orders triangles for the vertex cache.
+//  2. The cache-friendly order is cut into clusters, which are sorted outside-in by a
+//     view-independent occlusion estimate to reduce overdraw. Clusters are only split
+//     where the cache ratio stays within overdrawThreshold of the pass 1 result.
+//  3. Vertices are renumbered in first-use order so fetches walk the vertex buffer
+//     forwards; unreferenced vertices are dropped.
+// None of the passes change the rendered image.
+namespace MeshOptimizer {
+    constexpr unsigned int kCacheSize = 16;
+    constexpr float kOverdrawThreshold = 1.05f;
+    constexpr uint32_t kDroppedVertex = 0xFFFFFFFFu;
+
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, unsigned int cacheSize = kCacheSize);
+
+    // triangleOrder[newTriangle] = oldTriangle, composed with any order already in it.
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& triangleOrder, unsigned int cacheSize = kCacheSize);
+    void optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::vector<uint32_t>& triangleOrder,
+        float threshold = kOverdrawThreshold, unsigned int cacheSize = kCacheSize);
+    // Returns the vertex remap (see MeshOptimizationResult::vertexRemap).
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Runs all three passes. Leaves the mesh untouched (optimized == false) when the
+    // index buffer is not a valid triangle list for the vertices.
+    MeshOptimizationResult optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    std::string describe(const MeshOptimizationResult& result, size_t triangleCount);
+}
@@ -0,0 +1,319 @@
+#include "MeshSimplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "MeshOptimizer.hpp"
+
+namespace {
+    // Symmetric 4x4 plane quadric, upper triangle only, plus the area it was built from.
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        double weight = 0;
+
+        void addPlane(glm::dvec3 normal, double distance, double planeWeight) {
+            a2 += planeWeight * normal.x * normal.x;
+            ab += planeWeight * normal.x * normal.y;
+            ac += planeWeight * normal.x * normal.z;
+            ad += planeWeight * normal.x * distance;
+            b2 += planeWeight * normal.y * normal.y;
+            bc += planeWeight * normal.y * normal.z;
+            bd += planeWeight * normal.y * distance;
+            c2 += planeWeight * normal.z * normal.z;
+            cd += planeWeight * normal.z * distance;
+            d2 += planeWeight * distance * distance;
+            weight += planeWeight;
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Area-weighted mean squared distance of p to the accumulated planes.
+        double error(glm::vec3 p) const {
+            const double x = p.x, y = p.y, z = p.z;
+            const double value =
+                a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                c2 * z * z + 2 * cd * z +
+                d2;
+            return weight > 0.0 ? std::max(value, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey& other) const {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey& key) const {
+            return (static_cast<size_t>(key.bits[0]) * 73856093u) ^ (static_cast<size_t>(key.bits[1]) * 19349663u) ^ (static_cast<size_t>(key.bits[2]) * 83492791u);
+        }
+    };
+
+    // canonical[v] is the first vertex with v's exact position, so seams share topology.
+    std::vector<uint32_t> weldPositions(std::span<const Vertex> vertices) {
+        std::vector<uint32_t> canonical(vertices.size());
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstVertex;
+        firstVertex.reserve(vertices.size());
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            PositionKey key;
+            std::memcpy(key.bits, &vertices[v].position, sizeof(key.bits));
+            canonical[v] = firstVertex.emplace(key, static_cast<uint32_t>(v)).first->second;
+        }
+        return canonical;
+    }
+
+    // Seam vertices, and vertices on edges that are not shared by exactly two triangles.
+    std::vector<bool> findLockedVertices(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& canonical) {
+        std::vector<bool> locked(canonical.size(), false);
+        for (size_t v = 0; v < canonical.size(); ++v) {
+            if (canonical[v] != v) {
+                locked[v] = true;
+                locked[canonical[v]] = true;
+            }
+        }
+
+        std::vector<uint64_t> edges;
+        edges.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = canonical[indices[i + e]];
+                const uint32_t b = canonical[indices[i + (e + 1) % 3]];
+                edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t i = 0; i < edges.size();) {
+            size_t run = i + 1;
+            while (run < edges.size() && edges[run] == edges[i]) {
+                ++run;
+            }
+            if (run - i != 2) {
+                locked[static_cast<uint32_t>(edges[i] >> 32)] = true;
+                locked[static_cast<uint32_t>(edges[i])] = true;
+            }
+            i = run;
+        }
+
+        // Propagate from canonical vertices back to every wedge at that position.
+        for (size_t v = 0; v < canonical.size(); ++v) {
+            if (locked[canonical[v]]) {
+                locked[v] = true;
+            }
+        }
+        return locked;
+    }
+
+    glm::vec3 triangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2) {
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    size_t targetIndexCount, float targetError, float& resultError) {
+    resultError = 0.0f;
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    if (result.size() <= targetIndexCount || vertices.empty()) {
+        return result;
+    }
+
+    const size_t vertexCount = vertices.size();
+    const std::vector<uint32_t> canonical = weldPositions(vertices);
+    const std::vector<bool> locked = findLockedVertices(result, canonical);
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::vec3 p0 = vertices[result[i + 0]].position;
+        const glm::vec3 p1 = vertices[result[i + 1]].position;
+        const glm::vec3 p2 = vertices[result[i + 2]].position;
+        const glm::dvec3 normal = glm::dvec3(triangleNormal(p0, p1, p2));
+        const double length = glm::length(normal);
+        if (length <= 0.0) {
+            continue;
+        }
+        const glm::dvec3 unitNormal = normal / length;
+        const double distance = -glm::dot(unitNormal, glm::dvec3(p0));
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[canonical[result[i + corner]]].addPlane(unitNormal, distance, length * 0.5);
+        }
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    // Each pass commits the cheapest independent collapses (no two share a one-ring),
+    // then compacts the index list. Adjacency and costs are rebuilt between passes.
+    while (result.size() > targetIndexCount) {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+        for (uint32_t index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i) {
+                adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = result[i + e];
+                const uint32_t b = result[i + (e + 1) % 3];
+                // Collapsible edges are interior and manifold, so each is seen twice.
+                if (a > b) {
+                    continue;
+                }
+
+                Quadric combined = quadrics[canonical[a]];
+                combined += quadrics[canonical[b]];
+                Collapse best{ 0, 0, std::numeric_limits<float>::max() };
+                if (!locked[a]) {
+                    best = { a, b, static_cast<float>(combined.error(vertices[b].position)) };
+                }
+                if (!locked[b]) {
+                    const float error = static_cast<float>(combined.error(vertices[a].position));
+                    if (error < best.error) {
+                        best = { b, a, error };
+                    }
+                }
+                if (best.error != std::numeric_limits<float>::max()) {
+                    collapses.push_back(best);
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), false);
+        // Every collapse removes about two triangles.
+        const size_t collapseBudget = (result.size() - targetIndexCount) / 6 + 1;
+        const float errorLimit = targetError * targetError;
+        size_t committed = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (committed >= collapseBudget || collapse.error > errorLimit) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            bool flips = false;
+            const glm::vec3 target = vertices[collapse.to].position;
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; ++a) {
+                const uint32_t* triangle = &result[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (int corner = 0; corner < 3; ++corner) {
+                    before[corner] = vertices[triangle[corner]].position;
+                    after[corner] = triangle[corner] == collapse.from ? target : before[corner];
+                }
+                const glm::vec3 oldNormal = triangleNormal(before[0], before[1], before[2]);
+                const glm::vec3 newNormal = triangleNormal(after[0], after[1], after[2]);
+                // Also rejects turns past ~75 degrees, which become flips after later passes.
+                flips = glm::dot(oldNormal, newNormal) <= 0.25f * glm::length(oldNormal) * glm::length(newNormal);
+            }
+            if (flips) {
+                continue;
+            }
+
+            for (uint32_t vertex : { collapse.from, collapse.to }) {
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a) {
+                    const uint32_t* triangle = &result[adjacency[a] * 3];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                }
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[canonical[collapse.to]] += quadrics[canonical[collapse.from]];
+            resultError = std::max(resultError, std::sqrt(collapse.error));
+            committed++;
+        }
+        if (committed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i + 0]];
+            const uint32_t b = remap[result[i + 1]];
+            const uint32_t c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
+
+MeshLODChain MeshSimplifier::generateLODChain(std::span<const Vertex> vertices, std::span<const uint32_t> indices) {
+    MeshLODChain chain;
+    std::vector<uint32_t> previous(indices.begin(), indices.end());
+    float accumulatedError = 0.0f;
+
+    for (unsigned int level = 0; level < kMaxLevels; ++level) {
+        const size_t targetIndexCount = static_cast<size_t>(previous.size() / 3 * kLevelReduction) * 3;
+        if (targetIndexCount < kMinTriangles * 3) {
+            break;
+        }
+
+        float levelError = 0.0f;
+        std::vector<uint32_t> simplified = simplify(vertices, previous, targetIndexCount, std::numeric_limits<float>::max(), levelError);
+        // Stalled on locked borders/seams: a level that saves little is not worth a switch.
+        if (simplified.size() > previous.size() * 9 / 10) {
+            break;
+        }
+
+        std::vector<uint32_t> triangleOrder;
+        MeshOptimizer::optimizeVertexCache(simplified, vertices.size(), triangleOrder);
+
+        // Each level was simplified from the previous one, so deviations add up.
+        accumulatedError += levelError;
+        MeshLOD lod;
+        lod.firstIndex = static_cast<uint32_t>(chain.indices.size());
+        lod.indexCount = static_cast<uint32_t>(simplified.size());
+        lod.error = accumulatedError;
+        chain.levels.push_back(lod);
+        chain.indices.insert(chain.indices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+    return chain;
+}
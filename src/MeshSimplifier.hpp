@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Vertex.hpp"
+
+// One simplified level: a range of MeshLODChain::indices. error is the geometric
+// deviation from the full mesh in mesh-local units, used for screen-space selection.
+struct MeshLOD {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+// Coarser levels of one mesh, finest first. All levels index the mesh's own vertex
+// buffer, so a LOD switch only changes the index range that is drawn.
+struct MeshLODChain {
+    std::vector<uint32_t> indices;
+    std::vector<MeshLOD> levels;
+};
+
+// Quadric error metric edge collapse (Garland & Heckbert 1997) restricted to collapsing
+// a vertex onto a neighbour, so no new vertices are created. Vertices on open borders
+// and UV/normal seams (several vertices sharing one position) stay fixed; collapses
+// that would flip a triangle are rejected.
+namespace MeshSimplifier {
+    constexpr unsigned int kMaxLevels = 6;
+    constexpr float kLevelReduction = 0.5f;
+    constexpr size_t kMinTriangles = 64;
+
+    // Collapses edges, cheapest first, until the index count reaches targetIndexCount or
+    // the next collapse would exceed targetError. resultError receives the largest error
+    // committed.
+    std::vector<uint32_t> simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        size_t targetIndexCount, float targetError, float& resultError);
+
+    // Halves the triangle count per level until kMaxLevels, kMinTriangles or the
+    // simplifier stalls. Each level is reordered for the vertex cache.
+    MeshLODChain generateLODChain(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+}
@@ -0,0 +1,202 @@
+#include "Meshlet.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+    constexpr uint32_t kNotInMeshlet = 0xFFFFFFFFu;
+
+    void computeBounds(Meshlet& meshlet, std::span<const Vertex> vertices, std::span<const uint32_t> meshletIndices) {
+        glm::vec3 minimum(std::numeric_limits<float>::max());
+        glm::vec3 maximum(-std::numeric_limits<float>::max());
+        for (uint32_t index : meshletIndices) {
+            minimum = glm::min(minimum, vertices[index].position);
+            maximum = glm::max(maximum, vertices[index].position);
+        }
+        meshlet.center = (minimum + maximum) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (uint32_t index : meshletIndices) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[index].position - meshlet.center));
+        }
+
+        // Cone from the winding normals, which is what face orientation follows.
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshletIndices.size() / 3);
+        glm::vec3 axis(0.0f);
+        for (size_t i = 0; i < meshletIndices.size(); i += 3) {
+            const glm::vec3 p0 = vertices[meshletIndices[i + 0]].position;
+            const glm::vec3 p1 = vertices[meshletIndices[i + 1]].position;
+            const glm::vec3 p2 = vertices[meshletIndices[i + 2]].position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                axis += normals.back();
+            }
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f);
+        meshlet.coneCutoff = 1.0f;
+        const float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength <= 0.0f) {
+            return;
+        }
+        axis /= axisLength;
+
+        float minimumDot = 1.0f;
+        for (const glm::vec3& normal : normals) {
+            minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+        }
+        if (minimumDot <= 0.0f) {
+            return;
+        }
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+    }
+}
+
+MeshletSet MeshletBuilder::build(std::span<const Vertex> vertices, std::span<const uint32_t> indices) {
+    MeshletSet result;
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return result;
+    }
+    for (uint32_t index : indices) {
+        if (index >= vertices.size()) {
+            return result;
+        }
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+    for (uint32_t index : indices) {
+        adjacencyOffsets[index + 1]++;
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<bool> used(triangleCount, false);
+    // localSlot[v] marks vertices already in the current meshlet.
+    std::vector<uint32_t> localSlot(vertices.size(), kNotInMeshlet);
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    result.indices.reserve(indices.size());
+    size_t seedCursor = 0;
+    uint32_t nextSeed = kNotInMeshlet;
+
+    auto newVertexCount = [&](uint32_t triangle) {
+        size_t count = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            count += localSlot[indices[triangle * 3 + corner]] == kNotInMeshlet ? 1 : 0;
+        }
+        return count;
+    };
+
+    auto addTriangle = [&](uint32_t triangle) {
+        used[triangle] = true;
+        meshletTriangles.push_back(triangle);
+        for (int corner = 0; corner < 3; ++corner) {
+            const uint32_t vertex = indices[triangle * 3 + corner];
+            if (localSlot[vertex] == kNotInMeshlet) {
+                localSlot[vertex] = static_cast<uint32_t>(meshletVertices.size());
+                meshletVertices.push_back(vertex);
+            }
+        }
+    };
+
+    auto flush = [&]() {
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(result.indices.size());
+        meshlet.indexCount = static_cast<uint32_t>(meshletTriangles.size() * 3);
+        meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+        for (uint32_t triangle : meshletTriangles) {
+            result.indices.insert(result.indices.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+        }
+        computeBounds(meshlet, vertices, std::span<const uint32_t>(result.indices).subspan(meshlet.firstIndex));
+        result.meshlets.push_back(meshlet);
+
+        // The next meshlet grows from the border of this one, which keeps the leftover
+        // region connected instead of leaving small islands behind.
+        nextSeed = kNotInMeshlet;
+        size_t seedValence = std::numeric_limits<size_t>::max();
+        for (uint32_t vertex : meshletVertices) {
+            localSlot[vertex] = kNotInMeshlet;
+            size_t valence = 0;
+            uint32_t candidate = kNotInMeshlet;
+            for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a) {
+                if (!used[adjacency[a]]) {
+                    candidate = adjacency[a];
+                    valence++;
+                }
+            }
+            if (candidate != kNotInMeshlet && valence < seedValence) {
+                nextSeed = candidate;
+                seedValence = valence;
+            }
+        }
+        meshletVertices.clear();
+        meshletTriangles.clear();
+    };
+
+    while (true) {
+        if (nextSeed == kNotInMeshlet) {
+            while (seedCursor < triangleCount && used[seedCursor]) {
+                ++seedCursor;
+            }
+            if (seedCursor == triangleCount) {
+                break;
+            }
+            nextSeed = static_cast<uint32_t>(seedCursor);
+        }
+        addTriangle(nextSeed);
+        glm::vec3 centroidSum(0.0f);
+        for (uint32_t vertex : meshletVertices) {
+            centroidSum += vertices[vertex].position;
+        }
+
+        while (meshletTriangles.size() < kMaxTriangles) {
+            const glm::vec3 centroid = centroidSum / static_cast<float>(meshletVertices.size());
+            uint32_t best = kNotInMeshlet;
+            size_t bestNew = 4;
+            float bestDistance = std::numeric_limits<float>::max();
+
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a) {
+                    const uint32_t triangle = adjacency[a];
+                    if (used[triangle]) {
+                        continue;
+                    }
+                    const size_t added = newVertexCount(triangle);
+                    if (meshletVertices.size() + added > kMaxVertices || added > bestNew) {
+                        continue;
+                    }
+                    const glm::vec3 triangleCenter = (vertices[indices[triangle * 3]].position +
+                        vertices[indices[triangle * 3 + 1]].position + vertices[indices[triangle * 3 + 2]].position) / 3.0f;
+                    const float distance = glm::length(triangleCenter - centroid);
+                    if (added < bestNew || distance < bestDistance) {
+                        best = triangle;
+                        bestNew = added;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            if (best == kNotInMeshlet) {
+                break;
+            }
+
+            const size_t before = meshletVertices.size();
+            addTriangle(best);
+            for (size_t v = before; v < meshletVertices.size(); ++v) {
+                centroidSum += vertices[meshletVertices[v]].position;
+            }
+        }
+        flush();
+    }
+    return result;
+}
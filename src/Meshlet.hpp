@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Vertex.hpp"
+
+// A cluster of at most kMaxVertices vertices and kMaxTriangles triangles, drawn as one
+// range of MeshletSet::indices. Bounds are in mesh-local space.
+//  center/radius  bounding sphere of the cluster's vertices
+//  coneAxis/coneCutoff  normal cone; the whole cluster faces away from a viewer at v when
+//      dot(center - v, coneAxis) >= coneCutoff * |center - v| + radius.
+//      coneCutoff is 1 when the normals spread over a hemisphere or more (never culled).
+struct Meshlet {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t padding = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f;
+};
+
+// The mesh's full-detail triangles regrouped by meshlet. Uses the same vertex buffer.
+struct MeshletSet {
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+};
+
+namespace MeshletBuilder {
+    constexpr size_t kMaxVertices = 64;
+    constexpr size_t kMaxTriangles = 124;
+
+    // Greedy growth over triangle adjacency: each meshlet is seeded on the previous one's
+    // border, at an unused triangle touching the border vertex with the fewest unused
+    // triangles left, or at the first unused triangle when the border has none. It keeps
+    // adding the neighbouring triangle that brings the fewest new vertices, ties broken by
+    // distance to the meshlet centre, so clusters stay compact and their normal cones narrow.
+    MeshletSet build(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+    [[nodiscard]] inline bool isBackFacing(const Meshlet& meshlet, glm::vec3 viewer) {
+        const glm::vec3 toCenter = meshlet.center - viewer;
+        return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+    }
+}
@@ -0,0 +1,292 @@
+#include "MipGenerator.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP)
+#include <xmmintrin.h>
+#define MIP_GENERATOR_SSE 1
+#endif
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    // Kaiser support in destination texels either side of the centre, and window shape.
+    constexpr double kKaiserRadius = 2.0;
+    constexpr double kKaiserAlpha = 4.0;
+    // Texels per parallelFor chunk, so small levels stay on the calling thread.
+    constexpr size_t kChunkTexels = 16384;
+
+    struct alignas(16) Texel {
+        float v[4];
+    };
+
+    struct Tap {
+        int index;
+        float weight;
+    };
+
+    // tapCount taps per destination texel, unused ones weighted 0.
+    struct Kernel {
+        int tapCount = 0;
+        std::vector<Tap> taps;
+    };
+
+    float srgbToLinear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    const std::array<float, 256>& decodeTable(bool srgb) {
+        static const std::array<std::array<float, 256>, 2> tables = [] {
+            std::array<std::array<float, 256>, 2> built{};
+            for (int i = 0; i < 256; ++i) {
+                built[0][i] = i / 255.0f;
+                built[1][i] = srgbToLinear(i / 255.0f);
+            }
+            return built;
+        }();
+        return tables[srgb ? 1 : 0];
+    }
+
+    // Linear values halfway, in sRGB space, between consecutive bytes: encoding searches
+    // them, which rounds exactly where a pow-based encoder would.
+    const std::array<float, 255>& srgbThresholds() {
+        static const std::array<float, 255> thresholds = [] {
+            std::array<float, 255> built{};
+            for (int i = 0; i < 255; ++i) {
+                built[i] = srgbToLinear((i + 0.5f) / 255.0f);
+            }
+            return built;
+        }();
+        return thresholds;
+    }
+
+    unsigned char encodeChannel(float value, bool srgb) {
+        if (srgb) {
+            const std::array<float, 255>& thresholds = srgbThresholds();
+            return static_cast<unsigned char>(std::upper_bound(thresholds.begin(), thresholds.end(), value) - thresholds.begin());
+        }
+        return static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    double besselI0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32 && term > sum * 1e-12; ++k) {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    double kaiserWeight(double t) {
+        if (std::abs(t) >= kKaiserRadius) {
+            return 0.0;
+        }
+        const double sinc = t == 0.0 ? 1.0 : std::sin(kPi * t) / (kPi * t);
+        const double x = t / kKaiserRadius;
+        return sinc * besselI0(kKaiserAlpha * std::sqrt(1.0 - x * x)) / besselI0(kKaiserAlpha);
+    }
+
+    Kernel makeKernel(int sourceSize, int size, MipFilter filter) {
+        Kernel kernel;
+        if (size == sourceSize) {
+            kernel.tapCount = 1;
+            for (int i = 0; i < size; ++i) {
+                kernel.taps.push_back({ i, 1.0f });
+            }
+            return kernel;
+        }
+
+        if (filter == MipFilter::Box) {
+            if (sourceSize % 2 == 0) {
+                kernel.tapCount = 2;
+                for (int i = 0; i < size; ++i) {
+                    kernel.taps.push_back({ 2 * i, 0.5f });
+                    kernel.taps.push_back({ 2 * i + 1, 0.5f });
+                }
+            }
+            else {
+                // Polyphase box over 2*size+1 texels: each output covers 2+1/size of them.
+                kernel.tapCount = 3;
+                const float n = static_cast<float>(sourceSize);
+                for (int i = 0; i < size; ++i) {
+                    kernel.taps.push_back({ 2 * i, (size - i) / n });
+                    kernel.taps.push_back({ 2 * i + 1, size / n });
+                    kernel.taps.push_back({ 2 * i + 2, (i + 1) / n });
+                }
+            }
+            return kernel;
+        }
+
+        const double scale = static_cast<double>(sourceSize) / size;
+        const double support = kKaiserRadius * scale;
+        kernel.tapCount = static_cast<int>(std::ceil(2.0 * support)) + 1;
+        for (int i = 0; i < size; ++i) {
+            const double center = (i + 0.5) * scale - 0.5;
+            const int first = static_cast<int>(std::ceil(center - support));
+            std::vector<double> weights(kernel.tapCount);
+            double total = 0.0;
+            for (int k = 0; k < kernel.tapCount; ++k) {
+                weights[k] = kaiserWeight((first + k - center) / scale);
+                total += weights[k];
+            }
+            for (int k = 0; k < kernel.tapCount; ++k) {
+                const int index = ((first + k) % sourceSize + sourceSize) % sourceSize;
+                kernel.taps.push_back({ index, static_cast<float>(weights[k] / total) });
+            }
+        }
+        return kernel;
+    }
+
+    // sum += weight * texel, all four channels at once.
+    inline void accumulate(Texel& sum, const Texel& texel, float weight) {
+#ifdef MIP_GENERATOR_SSE
+        _mm_store_ps(sum.v, _mm_add_ps(_mm_load_ps(sum.v), _mm_mul_ps(_mm_load_ps(texel.v), _mm_set1_ps(weight))));
+#else
+        for (int c = 0; c < 4; ++c) {
+            sum.v[c] += weight * texel.v[c];
+        }
+#endif
+    }
+
+    void accumulateRow(Texel* row, const Texel* source, size_t count, float weight) {
+#ifdef MIP_GENERATOR_SSE
+        const __m128 scale = _mm_set1_ps(weight);
+        for (size_t i = 0; i < count; ++i) {
+            _mm_store_ps(row[i].v, _mm_add_ps(_mm_load_ps(row[i].v), _mm_mul_ps(_mm_load_ps(source[i].v), scale)));
+        }
+#else
+        for (size_t i = 0; i < count; ++i) {
+            accumulate(row[i], source[i], weight);
+        }
+#endif
+    }
+
+    size_t chunkRows(int width) {
+        return std::max<size_t>(1, kChunkTexels / std::max(width, 1));
+    }
+}
+
+int MipGenerator::levelCount(int width, int height, int depth) {
+    int levels = 1;
+    for (int size = std::max({ width, height, depth }); size > 1; size /= 2) {
+        levels++;
+    }
+    return levels;
+}
+
+std::vector<MipLevel> MipGenerator::build(const unsigned char* pixels, int width, int height, int depth, int channels,
+    const MipOptions& options, ThreadPool& pool) {
+    std::vector<MipLevel> levels;
+    if (!pixels || width <= 0 || height <= 0 || depth <= 0 || channels < 1 || channels > 4) {
+        return levels;
+    }
+
+    // Grey and grey-alpha images carry their colour in the first channel.
+    const int colourChannels = options.srgb ? (channels >= 3 ? 3 : 1) : 0;
+    std::array<const std::array<float, 256>*, 4> decode{};
+    for (int c = 0; c < 4; ++c) {
+        decode[c] = &decodeTable(c < colourChannels);
+    }
+
+    // Level 0 is decoded row by row as the first pass reads it; later levels come from
+    // the float copy of the previous one.
+    std::vector<Texel> current;
+    int sourceWidth = width, sourceHeight = height, sourceDepth = depth;
+    while (sourceWidth > 1 || sourceHeight > 1 || sourceDepth > 1) {
+        const int levelWidth = std::max(1, sourceWidth / 2);
+        const int levelHeight = std::max(1, sourceHeight / 2);
+        const int levelDepth = std::max(1, sourceDepth / 2);
+        const Kernel kernelX = makeKernel(sourceWidth, levelWidth, options.filter);
+        const Kernel kernelY = makeKernel(sourceHeight, levelHeight, options.filter);
+        const Kernel kernelZ = makeKernel(sourceDepth, levelDepth, options.filter);
+        const bool fromBytes = current.empty();
+
+        // Horizontal and vertical passes fused per output row: each contributing source row
+        // is filtered across into scratch and added in with its vertical weight.
+        std::vector<Texel> planar(static_cast<size_t>(levelWidth) * levelHeight * sourceDepth);
+        pool.parallelFor(0, static_cast<size_t>(levelHeight) * sourceDepth, [&](size_t begin, size_t end) {
+            std::vector<Texel> decoded(fromBytes ? sourceWidth : 0);
+            std::vector<Texel> filtered(levelWidth);
+            for (size_t row = begin; row < end; ++row) {
+                const size_t z = row / levelHeight;
+                const int y = static_cast<int>(row % levelHeight);
+                Texel* out = planar.data() + row * levelWidth;
+                std::fill(out, out + levelWidth, Texel{});
+                for (int ky = 0; ky < kernelY.tapCount; ++ky) {
+                    const Tap& tapY = kernelY.taps[static_cast<size_t>(y) * kernelY.tapCount + ky];
+                    if (tapY.weight == 0.0f) {
+                        continue;
+                    }
+                    const size_t sourceRow = z * sourceHeight + tapY.index;
+                    const Texel* source = nullptr;
+                    if (fromBytes) {
+                        const unsigned char* bytes = pixels + sourceRow * sourceWidth * channels;
+                        for (int x = 0; x < sourceWidth; ++x) {
+                            Texel& texel = decoded[x];
+                            for (int c = 0; c < 4; ++c) {
+                                texel.v[c] = c < channels ? (*decode[c])[bytes[x * channels + c]] : 0.0f;
+                            }
+                        }
+                        source = decoded.data();
+                    }
+                    else {
+                        source = current.data() + sourceRow * sourceWidth;
+                    }
+
+                    for (int x = 0; x < levelWidth; ++x) {
+                        Texel sum{};
+                        const Tap* taps = kernelX.taps.data() + static_cast<size_t>(x) * kernelX.tapCount;
+                        for (int kx = 0; kx < kernelX.tapCount; ++kx) {
+                            accumulate(sum, source[taps[kx].index], taps[kx].weight);
+                        }
+                        filtered[x] = sum;
+                    }
+                    accumulateRow(out, filtered.data(), levelWidth, tapY.weight);
+                }
+            }
+        }, chunkRows(levelWidth));
+
+        std::vector<Texel> next;
+        if (levelDepth == sourceDepth) {
+            next = std::move(planar);
+        }
+        else {
+            next.resize(static_cast<size_t>(levelWidth) * levelHeight * levelDepth);
+            const size_t sliceTexels = static_cast<size_t>(levelWidth) * levelHeight;
+            pool.parallelFor(0, static_cast<size_t>(levelHeight) * levelDepth, [&](size_t begin, size_t end) {
+                for (size_t row = begin; row < end; ++row) {
+                    const size_t z = row / levelHeight;
+                    const size_t y = row % levelHeight;
+                    Texel* out = next.data() + row * levelWidth;
+                    std::fill(out, out + levelWidth, Texel{});
+                    for (int kz = 0; kz < kernelZ.tapCount; ++kz) {
+                        const Tap& tap = kernelZ.taps[z * kernelZ.tapCount + kz];
+                        if (tap.weight != 0.0f) {
+                            accumulateRow(out, planar.data() + tap.index * sliceTexels + y * levelWidth, levelWidth, tap.weight);
+                        }
+                    }
+                }
+            }, chunkRows(levelWidth));
+        }
+
+        MipLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.depth = levelDepth;
+        level.pixels.resize(next.size() * channels);
+        pool.parallelFor(0, static_cast<size_t>(levelHeight) * levelDepth, [&](size_t begin, size_t end) {
+            for (size_t i = begin * levelWidth; i < end * levelWidth; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    level.pixels[i * channels + c] = encodeChannel(next[i].v[c], c < colourChannels);
+                }
+            }
+        }, chunkRows(levelWidth));
+        levels.push_back(std::move(level));
+
+        current = std::move(next);
+        sourceWidth = levelWidth;
+        sourceHeight = levelHeight;
+        sourceDepth = levelDepth;
+    }
+    return levels;
+}
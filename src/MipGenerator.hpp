@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.hpp"
+
+enum class MipFilter : uint32_t {
+    // 2x2 (2x2x2 for volumes) average; odd sizes blend three texels so none is dropped.
+    Box = 0,
+    // Kaiser-windowed sinc two destination texels wide: keeps more detail than the box
+    // at the cost of slight ringing, which is clamped away.
+    Kaiser = 1,
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Box;
+    // Colour channels hold sRGB-encoded values and are averaged in linear light. Alpha,
+    // and everything when this is off (noise, masks, packed data), is filtered as stored.
+    bool srgb = false;
+};
+
+// One generated level with the source's channel count, tightly packed. Volumes store
+// their depth slices back to back.
+struct MipLevel {
+    int width = 0;
+    int height = 0;
+    int depth = 1;
+    std::vector<unsigned char> pixels;
+};
+
+// CPU mip chains for 8-bit images and volumes of 1 to 4 channels. Each level halves
+// every axis longer than 1, as GL sizes levels, and is filtered separably from the
+// previous one; intermediate levels stay in float so rounding does not build up down
+// the chain. The passes use SSE where the compiler targets it and spread the rows of
+// every slice over the pool. Filter taps wrap around the edges, matching the GL_REPEAT
+// samplers the texture loaders set.
+namespace MipGenerator {
+    int levelCount(int width, int height, int depth = 1);
+
+    // Levels 1 down to 1x1x1; level 0 is pixels itself.
+    std::vector<MipLevel> build(const unsigned char* pixels, int width, int height, int depth, int channels,
+        const MipOptions& options = {}, ThreadPool& pool = globalThreadPool());
+}
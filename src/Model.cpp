@@ -1,58 +1,502 @@
 #include "Model.hpp"
+#include "TextureCache.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	size_t componentSize(unsigned int componentType)
+	{
+		switch (componentType)
+		{
+		case 5120: case 5121: return 1;
+		case 5122: case 5123: return 2;
+		case 5125: case 5126: return 4;
+		default: return 0;
+		}
+	}
 
-std::string Model::get_file_contents(const char* filename) {
-	std::ifstream in(filename, std::ios::binary);
-	if (in)
+	unsigned int componentCount(const std::string& type)
 	{
-		std::string contents;
-		in.seekg(0, std::ios::end);
-		contents.resize(in.tellg());
-		in.seekg(0, std::ios::beg);
-		in.read(&contents[0], contents.size());
-		in.close();
-		return(contents);
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	// glTF normalized integers: unsigned map to [0, 1], signed to [-1, 1] with the most
+	// negative value clamped.
+	template<typename T>
+	float toFloat(T value, bool normalized)
+	{
+		if constexpr (std::is_floating_point_v<T>)
+			return value;
+		else
+		{
+			if (!normalized)
+				return static_cast<float>(value);
+			constexpr float scale = 1.0f / static_cast<float>(std::numeric_limits<T>::max());
+			if constexpr (std::is_signed_v<T>)
+				return std::max(static_cast<float>(value) * scale, -1.0f);
+			else
+				return static_cast<float>(value) * scale;
+		}
+	}
+
+	// The type switch is hoisted out of the loop, so each instantiation is a flat strided
+	// copy; the float case is a fixed-size memcpy per element that compilers lower to
+	// vector moves.
+	template<typename T>
+	void decodeComponents(const unsigned char* source, size_t sourceStride, size_t count, unsigned int components,
+		bool normalized, unsigned char* destination, size_t destinationStride)
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			const size_t bytes = components * sizeof(float);
+			for (size_t i = 0; i < count; i++)
+				std::memcpy(destination + i * destinationStride, source + i * sourceStride, bytes);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const unsigned char* element = source + i * sourceStride;
+				float* out = reinterpret_cast<float*>(destination + i * destinationStride);
+				for (unsigned int c = 0; c < components; c++)
+				{
+					T value;
+					std::memcpy(&value, element + c * sizeof(T), sizeof(T));
+					out[c] = toFloat(value, normalized);
+				}
+			}
+		}
+	}
+
+	std::vector<unsigned char> decodeBase64(std::string_view text)
+	{
+		static const auto table = [] {
+			std::array<int8_t, 256> values;
+			values.fill(-1);
+			const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for (int i = 0; i < 64; i++)
+				values[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+			return values;
+		}();
+
+		std::vector<unsigned char> bytes;
+		bytes.reserve(text.size() / 4 * 3);
+		uint32_t accumulator = 0;
+		int bits = 0;
+		for (char c : text)
+		{
+			const int8_t value = table[static_cast<unsigned char>(c)];
+			if (value < 0)
+			{
+				if (c == '=')
+					break;
+				continue;
+			}
+			accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+			bits += 6;
+			if (bits >= 8)
+			{
+				bits -= 8;
+				bytes.push_back(static_cast<unsigned char>(accumulator >> bits));
+			}
+		}
+		return bytes;
 	}
-	throw(errno);
-}
 
-Model::Model(const char* file) {
-	std::string text = get_file_contents(file);
-	JSON = json::parse(text);
+	template<typename T>
+	void widenIndices(const unsigned char* source, size_t sourceStride, size_t count, GLuint* destination)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			T value;
+			std::memcpy(&value, source + i * sourceStride, sizeof(T));
+			destination[i] = static_cast<GLuint>(value);
+		}
+	}
+}
 
+Model::Model(const char* file, const ModelLoadOptions& options) {
 	Model::file = file;
-	data = getData();
+	Model::options = options;
+
+	if (cache.open(file))
+	{
+		if ((cache.getFlags() & cacheFlags()) == cacheFlags())
+		{
+			loadFromCache();
+			materials.build(meshes);
+			if (options.batchDraws)
+				drawBatch.build(meshes, materials);
+			return;
+		}
+		MyglobalLogger().logMessage(Logger::INFO, "Mesh cache " + MeshCache::pathFor(file) + " lacks the requested preprocessing, re-importing", __FILE__, __LINE__);
+	}
+
+	// One mapping serves both .gltf text and .glb containers; JSON is parsed in place.
+	if (!sourceFile.open(file))
+		throw std::runtime_error(std::string("Failed to open model: ") + file);
+
+	std::span<const unsigned char> jsonText = sourceFile.bytes();
+	std::span<const unsigned char> binChunk;
+	if (!parseGLB(sourceFile.bytes(), jsonText, binChunk) && isGLB(sourceFile.bytes()))
+		throw std::runtime_error(std::string("Malformed GLB container: ") + file);
+
+	JSON = json::parse(jsonText.begin(), jsonText.end());
+	loadBuffers(binChunk);
+	collectTextureRefs();
 
 	traverseNode(0);
+	loadMeshes();
+	materials.build(meshes);
+	if (options.batchDraws)
+		drawBatch.build(meshes, materials);
+}
+
+void Model::loadFromCache()
+{
+	const double startTime = glfwGetTime();
+	fromCache = true;
+	textureRefs = cache.getTextures();
+
+	for (const MeshCacheMesh& cached : cache.getMeshes())
+	{
+		std::vector<Vertex> vertices(cached.vertices.begin(), cached.vertices.end());
+		std::vector<GLuint> indices(cached.indices.begin(), cached.indices.end());
+		MeshLODChain lods;
+		lods.indices.assign(cached.lodIndices.begin(), cached.lodIndices.end());
+		lods.levels.assign(cached.lods.begin(), cached.lods.end());
+		MeshletSet meshlets;
+		meshlets.indices.assign(cached.meshletIndices.begin(), cached.meshletIndices.end());
+		meshlets.meshlets.assign(cached.meshlets.begin(), cached.meshlets.end());
+		std::vector<Texture> textures = getTextures();
+		meshes.push_back(Mesh(vertices, indices, textures, options.vertexFormat, std::move(lods), std::move(meshlets)));
+
+		translationsMeshes.push_back(cached.translation);
+		rotationsMeshes.push_back(cached.rotation);
+		scalesMeshes.push_back(cached.scale);
+		matricesMeshes.push_back(cached.matrix);
+		cachedMeshBVHs.push_back(cached.bvhNodes);
+	}
+
+	MyglobalLogger().logMessage(Logger::INFO, "Loaded " + std::to_string(meshes.size()) + " meshes from " +
+		MeshCache::pathFor(file) + " in " + std::to_string((glfwGetTime() - startTime) * 1000.0) + " ms", __FILE__, __LINE__);
+}
+
+bool Model::saveCache(const std::vector<std::span<const LBVHNode>>& meshBVHs) const
+{
+	if (fromCache)
+		return true;
+
+	std::vector<MeshCacheMesh> cached(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		cached[i].vertices = meshes[i].vertices;
+		cached[i].indices = meshes[i].indices;
+		if (i < meshBVHs.size())
+			cached[i].bvhNodes = meshBVHs[i];
+		cached[i].lodIndices = meshes[i].lodChain.indices;
+		cached[i].lods = meshes[i].lodChain.levels;
+		cached[i].meshletIndices = meshes[i].meshletSet.indices;
+		cached[i].meshlets = meshes[i].meshletSet.meshlets;
+		cached[i].bounds = meshes[i].bounds;
+		cached[i].matrix = matricesMeshes[i];
+		cached[i].translation = translationsMeshes[i];
+		cached[i].rotation = rotationsMeshes[i];
+		cached[i].scale = scalesMeshes[i];
+	}
+	return MeshCache::write(file, cached, textureRefs, cacheFlags(), bufferUris);
+}
+
+uint32_t Model::cacheFlags() const
+{
+	return (options.optimizeMeshes ? MeshCache::kFlagOptimized : 0u) | (options.generateLODs ? MeshCache::kFlagLODs : 0u) |
+		(options.buildMeshlets ? MeshCache::kFlagMeshlets : 0u);
 }
 
 
 void Model::Draw(Shader& shader, Camera& camera, glm::mat4 externalModel) {
+	lastDrawnTriangles = 0;
+	fullTriangles = 0;
+	visibleMeshlets = 0;
+	totalMeshlets = 0;
+	visibleMeshes = 0;
+	culledMeshes = 0;
+	const bool batched = drawBatch.isBuilt();
+	if (batched)
+		drawBatch.begin();
+	materials.bind(shader);
+
 	for (unsigned int i = 0; i < meshes.size(); i++)
 	{
-		shader.setMat4("model", externalModel * matricesMeshes[i]); 
-		meshes[i].Mesh::Draw(shader, camera);
+		const glm::mat4 world = externalModel * matricesMeshes[i];
+		fullTriangles += meshes[i].indices.size() / 3;
+		totalMeshlets += meshes[i].getMeshlets().size();
+		if (frustumCulling && !camera.getFrustum().intersectsBox(world, meshes[i].bounds.min, meshes[i].bounds.max))
+		{
+			culledMeshes++;
+			continue;
+		}
+		visibleMeshes++;
+		const size_t lod = selectLOD(i, world, camera);
+
+		// Meshlets partition the full-detail mesh only; coarser levels draw whole.
+		const bool drawMeshlets = lod == 0 && meshletCulling.enabled && meshes[i].hasMeshlets();
+		if (drawMeshlets)
+		{
+			cullMeshlets(i, world, camera, visibleMeshletList);
+			visibleMeshlets += visibleMeshletList.size();
+			for (uint32_t m : visibleMeshletList)
+				lastDrawnTriangles += meshes[i].getMeshlets()[m].indexCount / 3;
+		}
+		else
+		{
+			visibleMeshlets += meshes[i].getMeshlets().size();
+			lastDrawnTriangles += meshes[i].getLODIndexCount(lod) / 3;
+		}
+
+		if (batched)
+		{
+			const uint32_t draw = drawBatch.addDraw(i, world);
+			if (drawMeshlets)
+			{
+				batchRanges.clear();
+				meshes[i].appendMeshletRanges(visibleMeshletList, batchRanges);
+				for (const IndexRange& range : batchRanges)
+					drawBatch.addRange(draw, range);
+			}
+			else
+				drawBatch.addRange(draw, meshes[i].getLODRange(lod));
+			continue;
+		}
+
+		shader.setMat4("model", world); 
+		if (materials.getMode() == MaterialTable::Mode::Bound)
+			materials.bindMaterial(shader, meshes, materials.getMaterialIndex(i));
+		else
+			shader.setInt("drawMaterial", static_cast<int>(materials.getMaterialIndex(i)));
+		if (drawMeshlets)
+			meshes[i].DrawMeshlets(shader, camera, visibleMeshletList);
+		else
+			meshes[i].Mesh::Draw(shader, camera, lod);
+	}
+
+	if (batched)
+		drawBatch.submit(shader, meshes, materials);
+}
+
+void Model::setMeshletCulling(bool enabled, bool coneCulling)
+{
+	meshletCulling.enabled = enabled;
+	meshletCulling.coneCulling = coneCulling;
+}
+
+void Model::cullMeshlets(size_t meshIndex, const glm::mat4& world, const Camera& camera, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	const std::vector<Meshlet>& meshlets = meshes[meshIndex].getMeshlets();
+	const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+	// The cone test runs in mesh space; an affine inverse keeps it exact under
+	// non-uniform scale, where transformed normals would not.
+	const glm::vec3 localCamera = glm::vec3(glm::inverse(world) * glm::vec4(camera.Position, 1.0f));
+
+	for (size_t m = 0; m < meshlets.size(); m++)
+	{
+		const Meshlet& meshlet = meshlets[m];
+		if (meshletCulling.coneCulling && MeshletBuilder::isBackFacing(meshlet, localCamera))
+			continue;
+		const glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+		if (!camera.getFrustum().intersectsSphere(center, meshlet.radius * scale))
+			continue;
+		visible.push_back(static_cast<uint32_t>(m));
 	}
 }
 
-void Model::loadMesh(unsigned int indMesh)
+void Model::setLODSelection(bool enabled, float pixelScale, float maxPixelError)
 {
-	unsigned int posAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["POSITION"];
-	unsigned int normalAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["NORMAL"];
-	unsigned int texAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["TEXCOORD_0"];
-	unsigned int indAccInd = JSON["meshes"][indMesh]["primitives"][0]["indices"];
-
-	std::vector<float> posVec = getFloats(JSON["accessors"][posAccInd]);
-	std::vector<glm::vec3> positions = groupFloatsVec3(posVec);
-	std::vector<float> normalVec = getFloats(JSON["accessors"][normalAccInd]);
-	std::vector<glm::vec3> normals = groupFloatsVec3(normalVec);
-	std::vector<float> texVec = getFloats(JSON["accessors"][texAccInd]);
-	std::vector<glm::vec2> texUVs = groupFloatsVec2(texVec);
-
-	std::vector<Vertex> vertices = assembleVertices(positions, normals, texUVs);
-	std::vector<GLuint> indices = getIndices(JSON["accessors"][indAccInd]);
-	std::vector<Texture> textures = getTextures();
-
-	meshes.push_back(Mesh(vertices, indices, textures));
+	lodSelection.enabled = enabled;
+	lodSelection.pixelScale = pixelScale;
+	lodSelection.maxPixelError = maxPixelError;
+}
+
+size_t Model::selectLOD(size_t meshIndex, const glm::mat4& world, const Camera& camera) const
+{
+	const Mesh& mesh = meshes[meshIndex];
+	if (!lodSelection.enabled || lodSelection.pixelScale <= 0.0f || mesh.getLODCount() < 2)
+		return 0;
+
+	// Conservative distance: from the camera to the nearest point of the bounding sphere.
+	const AABB& bounds = mesh.bounds;
+	const glm::vec3 localCenter = (glm::vec3(bounds.min) + glm::vec3(bounds.max)) * 0.5f;
+	const float localRadius = glm::length(glm::vec3(bounds.max) - glm::vec3(bounds.min)) * 0.5f;
+	const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+	const glm::vec3 center = glm::vec3(world * glm::vec4(localCenter, 1.0f));
+	const float distance = glm::length(camera.Position - center) - localRadius * scale;
+	if (distance <= 0.0f)
+		return 0;
+
+	const float pixelsPerUnit = scale * lodSelection.pixelScale / distance;
+	for (size_t lod = mesh.getLODCount() - 1; lod > 0; lod--)
+	{
+		if (mesh.getLODError(lod) * pixelsPerUnit <= lodSelection.maxPixelError)
+			return lod;
+	}
+	return 0;
+}
+
+void Model::loadMeshes()
+{
+	const double startTime = glfwGetTime();
+
+	// One job per primitive of every mesh instance found by traverseNode.
+	struct PrimitiveJob
+	{
+		size_t instance;
+		unsigned int primitive;
+	};
+	std::vector<PrimitiveJob> jobs;
+	for (size_t i = 0; i < meshInstances.size(); i++)
+	{
+		const json& primitives = std::as_const(JSON)["meshes"][meshInstances[i].meshIndex]["primitives"];
+		for (unsigned int p = 0; p < primitives.size(); p++)
+			jobs.push_back({ i, p });
+	}
+
+	// Largest primitives first, so the biggest one starts right away and smaller ones fill
+	// in around it instead of queueing behind it.
+	std::vector<size_t> order(jobs.size());
+	std::vector<size_t> vertexCounts(jobs.size(), 0);
+	for (size_t j = 0; j < jobs.size(); j++)
+	{
+		const json& attributes = std::as_const(JSON)["meshes"][meshInstances[jobs[j].instance].meshIndex]["primitives"][jobs[j].primitive]["attributes"];
+		if (attributes.contains("POSITION"))
+			vertexCounts[j] = std::as_const(JSON)["accessors"][attributes["POSITION"].get<unsigned int>()].value("count", size_t(0));
+	}
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&vertexCounts](size_t a, size_t b) { return vertexCounts[a] > vertexCounts[b]; });
+
+	// Decoding only reads the mapped buffer and the (const) JSON, so it runs on the pool.
+	// Every thread pulls one primitive at a time off a shared counter: load time follows
+	// the largest primitive rather than the unluckiest fixed chunk.
+	std::vector<DecodedPrimitive> decoded(jobs.size());
+	ThreadPool& pool = globalThreadPool();
+	std::atomic<size_t> nextJob{ 0 };
+	pool.parallelFor(0, std::min<size_t>(jobs.size(), pool.getThreadCount()), [&](size_t, size_t) {
+		for (size_t next = nextJob++; next < order.size(); next = nextJob++)
+		{
+			const size_t j = order[next];
+			decoded[j] = decodePrimitive(meshInstances[jobs[j].instance].meshIndex, jobs[j].primitive);
+		}
+	}, 1);
+	const double decodeTime = glfwGetTime();
+
+	// Buffer and texture creation needs the GL context, which lives on this thread.
+	for (size_t j = 0; j < jobs.size(); j++)
+	{
+		if (decoded[j].vertices.empty())
+			continue;
+
+		const MeshInstance& instance = meshInstances[jobs[j].instance];
+		translationsMeshes.push_back(instance.translation);
+		rotationsMeshes.push_back(instance.rotation);
+		scalesMeshes.push_back(instance.scale);
+		matricesMeshes.push_back(instance.matrix);
+
+		std::vector<Texture> textures = getTextures();
+		meshes.push_back(Mesh(decoded[j].vertices, decoded[j].indices, textures, options.vertexFormat, std::move(decoded[j].lods),
+			std::move(decoded[j].meshlets)));
+	}
+	meshInstances.clear();
+
+	MyglobalLogger().logMessage(Logger::INFO,
+		"Loaded " + std::to_string(meshes.size()) + " primitives: decode " + std::to_string((decodeTime - startTime) * 1000.0) +
+		" ms on " + std::to_string(pool.getThreadCount()) + " threads, upload " + std::to_string((glfwGetTime() - decodeTime) * 1000.0) + " ms",
+		__FILE__, __LINE__);
+}
+
+Model::DecodedPrimitive Model::decodePrimitive(unsigned int indMesh, unsigned int indPrimitive) const
+{
+	DecodedPrimitive result;
+	const json& primitive = JSON["meshes"][indMesh]["primitives"][indPrimitive];
+	const json& attributes = primitive["attributes"];
+
+	if (primitive.value("mode", 4) != 4 || !attributes.contains("POSITION"))
+	{
+		MyglobalLogger().logMessage(Logger::WARNING, "Skipping non-triangle glTF primitive " + std::to_string(indPrimitive) +
+			" of mesh " + std::to_string(indMesh), __FILE__, __LINE__);
+		return result;
+	}
+
+	const json& posAccessor = JSON["accessors"][attributes["POSITION"].get<unsigned int>()];
+	const size_t vertexCount = posAccessor["count"].get<size_t>();
+	// Valid glTF, but there is nothing to draw; empty results are skipped by loadMeshes.
+	if (vertexCount == 0)
+		return result;
+
+	// Attributes are decoded in place into the interleaved array; missing ones keep the
+	// Vertex defaults.
+	std::vector<Vertex>& vertices = result.vertices;
+	vertices.assign(vertexCount, Vertex(glm::vec3(0.0f)));
+	decodeAccessor(posAccessor, &vertices.data()->position, sizeof(Vertex), 3, vertices.size());
+	if (attributes.contains("NORMAL"))
+		decodeAccessor(JSON["accessors"][attributes["NORMAL"].get<unsigned int>()], &vertices.data()->normal, sizeof(Vertex), 3, vertices.size());
+	if (attributes.contains("TEXCOORD_0"))
+		decodeAccessor(JSON["accessors"][attributes["TEXCOORD_0"].get<unsigned int>()], &vertices.data()->texCoords, sizeof(Vertex), 2, vertices.size());
+
+	if (primitive.contains("indices"))
+		result.indices = getIndices(JSON["accessors"][primitive["indices"].get<unsigned int>()]);
+	else
+	{
+		result.indices.resize(vertices.size());
+		std::iota(result.indices.begin(), result.indices.end(), 0u);
+	}
+
+	if (options.optimizeMeshes)
+	{
+		const MeshOptimizationResult optimization = MeshOptimizer::optimizeMesh(vertices, result.indices);
+		if (optimization.optimized)
+			MyglobalLogger().logMessage(Logger::INFO, "Optimized mesh " + std::to_string(indMesh) + " primitive " + std::to_string(indPrimitive) +
+				": " + MeshOptimizer::describe(optimization, result.indices.size() / 3), __FILE__, __LINE__);
+		else
+			MyglobalLogger().logMessage(Logger::WARNING, "Mesh " + std::to_string(indMesh) + " primitive " + std::to_string(indPrimitive) +
+				" has an invalid index buffer, left unoptimized", __FILE__, __LINE__);
+	}
+
+	if (options.generateLODs)
+	{
+		result.lods = MeshSimplifier::generateLODChain(vertices, result.indices);
+		std::string levels;
+		for (const MeshLOD& lod : result.lods.levels)
+			levels += " -> " + std::to_string(lod.indexCount / 3) + " (error " + std::to_string(lod.error) + ")";
+		MyglobalLogger().logMessage(Logger::INFO, "LODs for mesh " + std::to_string(indMesh) + " primitive " + std::to_string(indPrimitive) +
+			": " + std::to_string(result.indices.size() / 3) + levels, __FILE__, __LINE__);
+	}
+
+	if (options.buildMeshlets)
+	{
+		result.meshlets = MeshletBuilder::build(vertices, result.indices);
+		MyglobalLogger().logMessage(Logger::INFO, "Meshlets for mesh " + std::to_string(indMesh) + " primitive " + std::to_string(indPrimitive) +
+			": " + std::to_string(result.meshlets.meshlets.size()) + " clusters of up to " + std::to_string(MeshletBuilder::kMaxVertices) +
+			" vertices / " + std::to_string(MeshletBuilder::kMaxTriangles) + " triangles", __FILE__, __LINE__);
+	}
+
+	return result;
 }
 
 void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
@@ -108,12 +552,7 @@ void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
 
 	if (node.find("mesh") != node.end())
 	{
-		translationsMeshes.push_back(translation);
-		rotationsMeshes.push_back(rotation);
-		scalesMeshes.push_back(scale);
-		matricesMeshes.push_back(matNextNode);
-
-		loadMesh(node["mesh"]);
+		meshInstances.push_back({ node["mesh"].get<unsigned int>(), translation, rotation, scale, matNextNode });
 	}
 
 	if (node.find("children") != node.end())
@@ -123,96 +562,202 @@ void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
 	}
 }
 
-std::vector<unsigned char> Model::getData()
+bool Model::isGLB(std::span<const unsigned char> file)
+{
+	return file.size() >= 4 && std::memcmp(file.data(), "glTF", 4) == 0;
+}
+
+bool Model::parseGLB(std::span<const unsigned char> file, std::span<const unsigned char>& jsonChunk, std::span<const unsigned char>& binChunk)
 {
-	std::string bytesText;
-	std::string uri = JSON["buffers"][0]["uri"];
+	// 12-byte header (magic, version, length) followed by 8-byte-headed chunks: JSON first,
+	// then an optional BIN chunk.
+	constexpr uint32_t kChunkJSON = 0x4E4F534A;
+	constexpr uint32_t kChunkBIN = 0x004E4942;
+	if (!isGLB(file) || file.size() < 20)
+		return false;
+
+	uint32_t header[3];
+	std::memcpy(header, file.data(), sizeof(header));
+	if (header[1] != 2 || header[2] > file.size())
+		return false;
+
+	size_t offset = 12;
+	bool foundJSON = false;
+	while (offset + 8 <= header[2])
+	{
+		uint32_t chunk[2];
+		std::memcpy(chunk, file.data() + offset, sizeof(chunk));
+		offset += 8;
+		if (chunk[0] > header[2] - offset)
+			return false;
 
+		if (chunk[1] == kChunkJSON && !foundJSON)
+		{
+			jsonChunk = file.subspan(offset, chunk[0]);
+			foundJSON = true;
+		}
+		else if (chunk[1] == kChunkBIN && binChunk.empty())
+			binChunk = file.subspan(offset, chunk[0]);
+		offset += (chunk[0] + 3) & ~size_t(3);
+	}
+	return foundJSON;
+}
+
+void Model::loadBuffers(std::span<const unsigned char> binChunk)
+{
 	std::string fileStr = std::string(file);
 	std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
-	bytesText = get_file_contents((fileDirectory + uri).c_str());
 
-	std::vector<unsigned char> data(bytesText.begin(), bytesText.end());
-	return data;
+	const json& gltfBuffers = std::as_const(JSON)["buffers"];
+	buffers.resize(gltfBuffers.size());
+	bufferFiles.resize(gltfBuffers.size());
+	embeddedBuffers.resize(gltfBuffers.size());
+
+	for (size_t i = 0; i < gltfBuffers.size(); i++)
+	{
+		const json& buffer = gltfBuffers[i];
+		const size_t byteLength = buffer.value("byteLength", size_t(0));
+
+		if (!buffer.contains("uri"))
+		{
+			// Only the first buffer of a GLB may omit its uri; it is the BIN chunk.
+			if (i != 0 || binChunk.size() < byteLength)
+				throw std::runtime_error("glTF buffer " + std::to_string(i) + " has no uri and no GLB BIN chunk");
+			buffers[i] = binChunk.first(byteLength);
+			continue;
+		}
+
+		const std::string uri = buffer["uri"];
+		if (uri.rfind("data:", 0) == 0)
+		{
+			const size_t comma = uri.find(',');
+			if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+				throw std::runtime_error("glTF buffer " + std::to_string(i) + " uses an unsupported data URI");
+			embeddedBuffers[i] = decodeBase64(std::string_view(uri).substr(comma + 1));
+			buffers[i] = embeddedBuffers[i];
+		}
+		else
+		{
+			if (!bufferFiles[i].open(fileDirectory + uri))
+				throw std::runtime_error("Failed to map glTF buffer: " + fileDirectory + uri);
+			buffers[i] = bufferFiles[i].bytes();
+			bufferUris.push_back(uri);
+		}
+
+		if (buffers[i].size() < byteLength)
+			throw std::runtime_error("glTF buffer " + std::to_string(i) + " is shorter than its byteLength");
+	}
 }
 
-std::vector<float> Model::getFloats(json accessor)
+std::span<const unsigned char> Model::getBuffer(const json& bufferView) const
 {
-	std::vector<float> floatVec;
-
-	unsigned int buffViewInd = accessor.value("bufferView", 1);
-	unsigned int count = accessor["count"];
-	unsigned int accByteOffset = accessor.value("byteOffset", 0);
-	std::string type = accessor["type"];
+	const size_t index = bufferView.value("buffer", size_t(0));
+	return index < buffers.size() ? buffers[index] : std::span<const unsigned char>();
+}
 
-	json bufferView = JSON["bufferViews"][buffViewInd];
-	unsigned int byteOffset = bufferView["byteOffset"];
+const unsigned char* Model::getAccessorData(const json& accessor, size_t elementSize, size_t& byteStride, size_t& count) const
+{
+	count = accessor["count"].get<size_t>();
+	if (!accessor.contains("bufferView"))
+		return nullptr;
 
-	unsigned int numPerVert;
-	if (type == "SCALAR") numPerVert = 1;
-	else if (type == "VEC2") numPerVert = 2;
-	else if (type == "VEC3") numPerVert = 3;
-	else if (type == "VEC4") numPerVert = 4;
-	else throw std::invalid_argument("Type is invalid (not SCALAR, VEC2, VEC3, or VEC4)");
+	const json& bufferView = JSON["bufferViews"][accessor["bufferView"].get<unsigned int>()];
+	byteStride = bufferView.value("byteStride", elementSize);
 
-	unsigned int beginningOfData = byteOffset + accByteOffset;
-	unsigned int lengthOfData = count * 4 * numPerVert;
-	for (unsigned int i = beginningOfData; i < beginningOfData + lengthOfData; i += 4)
+	const size_t begin = bufferView.value("byteOffset", size_t(0)) + accessor.value("byteOffset", size_t(0));
+	const std::span<const unsigned char> buffer = getBuffer(bufferView);
+	if (count == 0 || byteStride < elementSize || begin + (count - 1) * byteStride + elementSize > buffer.size())
 	{
-		unsigned char bytes[] = { data[i], data[i + 1], data[i + 2], data[i + 3] };
-		float value;
-		std::memcpy(&value, bytes, sizeof(float));
-		floatVec.push_back(value);
+		MyglobalLogger().logMessage(Logger::ERROR, "glTF accessor exceeds its buffer", __FILE__, __LINE__);
+		return nullptr;
 	}
 
-	return floatVec;
+	return buffer.data() + begin;
 }
 
-std::vector<GLuint> Model::getIndices(json accessor)
+size_t Model::decodeAccessor(const json& accessor, void* destination, size_t destinationStride, unsigned int destinationComponents, size_t maxCount) const
 {
-	std::vector<GLuint> indices;
-
-	unsigned int buffViewInd = accessor.value("bufferView", 0);
-	unsigned int count = accessor["count"];
-	unsigned int accByteOffset = accessor.value("byteOffset", 0);
-	unsigned int componentType = accessor["componentType"];
+	const unsigned int componentType = accessor["componentType"];
+	const unsigned int components = std::min(componentCount(accessor["type"]), destinationComponents);
+	const size_t elementSize = componentSize(componentType) * componentCount(accessor["type"]);
+	if (elementSize == 0 || components == 0)
+		return 0;
+
+	size_t byteStride = 0;
+	size_t count = 0;
+	const unsigned char* source = getAccessorData(accessor, elementSize, byteStride, count);
+	if (!source)
+		return 0;
+	count = std::min(count, maxCount);
+
+	const bool normalized = accessor.value("normalized", false);
+	unsigned char* dst = static_cast<unsigned char*>(destination);
+	switch (componentType)
+	{
+	case 5120: decodeComponents<int8_t>(source, byteStride, count, components, normalized, dst, destinationStride); break;
+	case 5121: decodeComponents<uint8_t>(source, byteStride, count, components, normalized, dst, destinationStride); break;
+	case 5122: decodeComponents<int16_t>(source, byteStride, count, components, normalized, dst, destinationStride); break;
+	case 5123: decodeComponents<uint16_t>(source, byteStride, count, components, normalized, dst, destinationStride); break;
+	case 5125: decodeComponents<uint32_t>(source, byteStride, count, components, false, dst, destinationStride); break;
+	case 5126: decodeComponents<float>(source, byteStride, count, components, false, dst, destinationStride); break;
+	default:
+		MyglobalLogger().logMessage(Logger::ERROR, "Unsupported glTF componentType " + std::to_string(componentType), __FILE__, __LINE__);
+		return 0;
+	}
+	return count;
+}
 
-	json bufferView = JSON["bufferViews"][buffViewInd];
-	unsigned int byteOffset = bufferView["byteOffset"];
+std::vector<GLuint> Model::getIndices(const json& accessor) const
+{
+	const unsigned int componentType = accessor["componentType"];
+	const size_t elementSize = componentSize(componentType);
 
-	unsigned int beginningOfData = byteOffset + accByteOffset;
 	if (componentType == 5125)
 	{
-		for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 4; i += 4)
-		{
-			unsigned char bytes[] = { data[i], data[i + 1], data[i + 2], data[i + 3] };
-			unsigned int value;
-			std::memcpy(&value, bytes, sizeof(unsigned int));
-			indices.push_back((GLuint)value);
-		}
+		std::span<const GLuint> packed = getAccessorSpan<GLuint>(accessor, 1);
+		if (!packed.empty())
+			return std::vector<GLuint>(packed.begin(), packed.end());
 	}
-	else if (componentType == 5123)
+
+	size_t byteStride = 0;
+	size_t count = 0;
+	const unsigned char* source = getAccessorData(accessor, elementSize, byteStride, count);
+	if (!source || elementSize == 0)
+		return {};
+
+	std::vector<GLuint> indices(count);
+	switch (componentType)
 	{
-		for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 2; i += 2)
-		{
-			unsigned char bytes[] = { data[i], data[i + 1] };
-			unsigned short value;
-			std::memcpy(&value, bytes, sizeof(unsigned short));
-			indices.push_back((GLuint)value);
-		}
+	case 5121: widenIndices<uint8_t>(source, byteStride, count, indices.data()); break;
+	case 5122: widenIndices<int16_t>(source, byteStride, count, indices.data()); break;
+	case 5123: widenIndices<uint16_t>(source, byteStride, count, indices.data()); break;
+	case 5125: widenIndices<uint32_t>(source, byteStride, count, indices.data()); break;
+	default:
+		MyglobalLogger().logMessage(Logger::ERROR, "Unsupported glTF index componentType " + std::to_string(componentType), __FILE__, __LINE__);
+		return {};
 	}
-	else if (componentType == 5122)
+	return indices;
+}
+
+void Model::collectTextureRefs()
+{
+	const json& images = std::as_const(JSON).value("images", json::array());
+	for (unsigned int i = 0; i < images.size(); i++)
 	{
-		for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 2; i += 2)
+		// Images stored in a bufferView or a data URI are not decoded yet.
+		const json& image = images[i];
+		if (!image.contains("uri") || image["uri"].get<std::string>().rfind("data:", 0) == 0)
 		{
-			unsigned char bytes[] = { data[i], data[i + 1] };
-			short value;
-			std::memcpy(&value, bytes, sizeof(short));
-			indices.push_back((GLuint)value);
+			MyglobalLogger().logMessage(Logger::WARNING, "Skipping embedded glTF image " + std::to_string(i), __FILE__, __LINE__);
+			continue;
 		}
-	}
 
-	return indices;
+		std::string texPath = image["uri"];
+		if (texPath.find("baseColor") != std::string::npos)
+			textureRefs.push_back({ texPath, "diffuse" });
+		else if (texPath.find("metallicRoughness") != std::string::npos)
+			textureRefs.push_back({ texPath, "specular" });
+	}
 }
 
 std::vector<Texture> Model::getTextures()
@@ -222,14 +767,12 @@ std::vector<Texture> Model::getTextures()
 	std::string fileStr = std::string(file);
 	std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
 
-	for (unsigned int i = 0; i < JSON["images"].size(); i++)
+	for (const MeshCacheTexture& ref : textureRefs)
 	{
-		std::string texPath = JSON["images"][i]["uri"];
-
 		bool skip = false;
 		for (unsigned int j = 0; j < loadedTexName.size(); j++)
 		{
-			if (loadedTexName[j] == texPath)
+			if (loadedTexName[j] == ref.uri)
 			{
 				textures.push_back(loadedTex[j]);
 				skip = true;
@@ -239,93 +782,14 @@ std::vector<Texture> Model::getTextures()
 
 		if (!skip)
 		{
-			if (texPath.find("baseColor") != std::string::npos)
-			{
-				Texture diffuse = Texture((fileDirectory + texPath).c_str(), "diffuse", loadedTex.size());
-				textures.push_back(diffuse);
-				loadedTex.push_back(diffuse);
-				loadedTexName.push_back(texPath);
-			}
-			else if (texPath.find("metallicRoughness") != std::string::npos)
-			{
-				Texture specular = Texture((fileDirectory + texPath).c_str(), "specular", loadedTex.size());
-				textures.push_back(specular);
-				loadedTex.push_back(specular);
-				loadedTexName.push_back(texPath);
-			}
+			// Shared with every other model using the same image.
+			globalTextureCache().setContentHashing(options.hashTextureContent);
+			TextureCache::Handle handle = globalTextureCache().acquire(fileDirectory + ref.uri, options.streamTextures, options.compressTextures, ref.type == "diffuse");
+			loadedTex.push_back(Texture(std::move(handle), ref.type.c_str(), loadedTex.size()));
+			textures.push_back(loadedTex.back());
+			loadedTexName.push_back(ref.uri);
 		}
 	}
 
 	return textures;
 }
-
-std::vector<Vertex> Model::assembleVertices
-(
-	std::vector<glm::vec3> positions,
-	std::vector<glm::vec3> normals,
-	std::vector<glm::vec2> texUVs
-)
-{
-	std::vector<Vertex> vertices;
-	for (int i = 0; i < positions.size(); i++)
-	{
-		vertices.push_back(
-			Vertex{
-				positions[i],                  
-				normals[i],                    
-				glm::vec3(1.0f, 1.0f, 1.0f),   
-				texUVs[i]                      
-			}
-		);
-	}
-	return vertices;
-}
-
-std::vector<glm::vec2> Model::groupFloatsVec2(std::vector<float> floatVec)
-{
-	const unsigned int floatsPerVector = 2;
-
-	std::vector<glm::vec2> vectors;
-	for (unsigned int i = 0; i < floatVec.size(); i += floatsPerVector)
-	{
-		vectors.push_back(glm::vec2(0, 0));
-
-		for (unsigned int j = 0; j < floatsPerVector; j++)
-		{
-			vectors.back()[j] = floatVec[i + j];
-		}
-	}
-	return vectors;
-}
-std::vector<glm::vec3> Model::groupFloatsVec3(std::vector<float> floatVec)
-{
-	const unsigned int floatsPerVector = 3;
-
-	std::vector<glm::vec3> vectors;
-	for (unsigned int i = 0; i < floatVec.size(); i += floatsPerVector)
-	{
-		vectors.push_back(glm::vec3(0, 0, 0));
-
-		for (unsigned int j = 0; j < floatsPerVector; j++)
-		{
-			vectors.back()[j] = floatVec[i + j];
-		}
-	}
-	return vectors;
-}
-std::vector<glm::vec4> Model::groupFloatsVec4(std::vector<float> floatVec)
-{
-	const unsigned int floatsPerVector = 4;
-
-	std::vector<glm::vec4> vectors;
-	for (unsigned int i = 0; i < floatVec.size(); i += floatsPerVector)
-	{
-		vectors.push_back(glm::vec4(0, 0, 0, 0));
-
-		for (unsigned int j = 0; j < floatsPerVector; j++)
-		{
-			vectors.back()[j] = floatVec[i + j];
-		}
-	}
-	return vectors;
-}
\ No newline at end of file
@@ -1,23 +1,89 @@
 #pragma once
 
 #include <json.h>
+#include <span>
+#include "DrawBatch.hpp"
 #include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
 
 using json = nlohmann::json;
 
+struct ModelLoadOptions
+{
+	// Runs MeshOptimizer on every imported primitive; a cache written without it is
+	// re-imported.
+	bool optimizeMeshes = false;
+	// Layout of the GPU vertex buffers. Mesh::vertices stays float either way.
+	VertexFormat vertexFormat = VertexFormat::Float;
+	// Builds a QEM-simplified LOD chain per primitive; cached like optimizeMeshes.
+	bool generateLODs = false;
+	// Partitions every primitive into meshlets for per-cluster culling; cached likewise.
+	bool buildMeshlets = false;
+	// Packs all meshes into shared buffers drawn with glMultiDrawElementsIndirect.
+	bool batchDraws = false;
+	// Decodes textures on the thread pool and streams them in over several frames;
+	// meshes sample a grey placeholder until then.
+	bool streamTextures = false;
+	// Loads textures as BC1/BC3/BC5 from a <image>.ctex cache, encoding it on first use.
+	bool compressTextures = false;
+	// Also keys the texture cache by file content, so copies under other paths share one
+	// texture. Costs a read and hash of every image on load.
+	bool hashTextureContent = false;
+};
+
 class Model {
 public:
-	Model(const char* file);
+	Model(const char* file, const ModelLoadOptions& options = {});
 
 	void Draw(Shader& shader, Camera& camera, glm::mat4 externalModel = glm::mat4(1.0f));  
 
-	std::string get_file_contents(const char* filename);
+	// Draw picks the coarsest LOD whose error projects to at most maxPixelError pixels.
+	// pixelScale converts world error at unit distance to pixels:
+	// projection[1][1] * viewportHeight / 2.
+	void setLODSelection(bool enabled, float pixelScale, float maxPixelError);
+	size_t getLastDrawnTriangles() const { return lastDrawnTriangles; }
+	size_t getFullTriangles() const { return fullTriangles; }
+
+	// Draw skips meshes whose bounds lie outside camera.getFrustum(); the counters cover
+	// the last Draw.
+	void setFrustumCulling(bool enabled) { frustumCulling = enabled; }
+	size_t getVisibleMeshes() const { return visibleMeshes; }
+	size_t getCulledMeshes() const { return culledMeshes; }
+
+	// Meshes drawn at full detail skip meshlets outside the camera frustum and, with
+	// coneCulling, meshlets whose normal cone faces away from the camera.
+	void setMeshletCulling(bool enabled, bool coneCulling);
+	size_t getVisibleMeshlets() const { return visibleMeshlets; }
+	size_t getTotalMeshlets() const { return totalMeshlets; }
+
+	// Zero when the model is not batched: Draw then issues calls per mesh.
+	size_t getIndirectCommands() const { return drawBatch.getLastCommandCount(); }
+	size_t getIndirectDrawCalls() const { return drawBatch.getLastDrawCalls(); }
+	const MaterialTable& getMaterials() const { return materials; }
 
 	std::vector<Mesh> meshes;
 	const std::vector<glm::mat4>& getMeshLocalMatrices() const { return matricesMeshes; }
+
+	// Warm starts load from <model>.meshcache and skip the glTF import entirely.
+	bool isFromCache() const { return fromCache; }
+	// Per-mesh BVH nodes stored in the cache; empty spans when the cache had none.
+	const std::vector<std::span<const LBVHNode>>& getCachedMeshBVHs() const { return cachedMeshBVHs; }
+	// Writes the cache for a freshly imported model; meshBVHs may be empty.
+	bool saveCache(const std::vector<std::span<const LBVHNode>>& meshBVHs) const;
 private:
 	const char* file;
-	std::vector<unsigned char> data;
+	ModelLoadOptions options;
+	// The .gltf/.glb file stays mapped: for GLB the BIN chunk is read in place.
+	MappedFile sourceFile;
+	// buffers[i] views glTF buffer i: a mapped .bin, the GLB BIN chunk or a decoded
+	// data URI. Accessors are spans into these, never copies.
+	std::vector<std::span<const unsigned char>> buffers;
+	std::vector<MappedFile> bufferFiles;
+	std::vector<std::vector<unsigned char>> embeddedBuffers;
+	// Uris of the external buffers, relative to the model; the mesh cache checks them too.
+	std::vector<std::string> bufferUris;
 	json JSON;
 
 	std::vector<glm::vec3> translationsMeshes;
@@ -25,25 +91,109 @@ private:
 	std::vector<glm::vec3> scalesMeshes;
 	std::vector<glm::mat4> matricesMeshes;
 
+	struct LODSelection
+	{
+		bool enabled = false;
+		float pixelScale = 0.0f;
+		float maxPixelError = 1.0f;
+	};
+	LODSelection lodSelection;
+	size_t lastDrawnTriangles = 0;
+	size_t fullTriangles = 0;
+	size_t selectLOD(size_t meshIndex, const glm::mat4& world, const Camera& camera) const;
+
+	struct MeshletCulling
+	{
+		bool enabled = false;
+		bool coneCulling = true;
+	};
+	MeshletCulling meshletCulling;
+	bool frustumCulling = true;
+	size_t visibleMeshes = 0;
+	size_t culledMeshes = 0;
+	size_t visibleMeshlets = 0;
+	size_t totalMeshlets = 0;
+	// Reused by Draw so culling does not allocate per frame.
+	std::vector<uint32_t> visibleMeshletList;
+	std::vector<IndexRange> batchRanges;
+	DrawBatch drawBatch;
+	// Declared after meshes, so handles are released while their textures still exist.
+	MaterialTable materials;
+	void cullMeshlets(size_t meshIndex, const glm::mat4& world, const Camera& camera, std::vector<uint32_t>& visible) const;
+
+	MeshCache cache;
+	bool fromCache = false;
+	std::vector<std::span<const LBVHNode>> cachedMeshBVHs;
+
+	std::vector<MeshCacheTexture> textureRefs;
 	std::vector<std::string> loadedTexName;
 	std::vector<Texture> loadedTex;
 
-	void loadMesh(unsigned int indMesh);
+	// Mesh references collected by traverseNode; loadMeshes turns each of their
+	// primitives into one Mesh.
+	struct MeshInstance
+	{
+		unsigned int meshIndex;
+		glm::vec3 translation;
+		glm::quat rotation;
+		glm::vec3 scale;
+		glm::mat4 matrix;
+	};
+	std::vector<MeshInstance> meshInstances;
+
+	struct DecodedPrimitive
+	{
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		MeshLODChain lods;
+		MeshletSet meshlets;
+	};
+
+	uint32_t cacheFlags() const;
+	void loadFromCache();
+	void loadMeshes();
+	// Thread-safe: reads only the const JSON and the mapped buffer.
+	DecodedPrimitive decodePrimitive(unsigned int indMesh, unsigned int indPrimitive) const;
 
 	void traverseNode(unsigned int nextNode, glm::mat4 matrix = glm::mat4(1.0f));
 
-	std::vector<unsigned char> getData();
-	std::vector<float> getFloats(json accessor);
-	std::vector<GLuint> getIndices(json accessor);
+	static bool isGLB(std::span<const unsigned char> file);
+	static bool parseGLB(std::span<const unsigned char> file, std::span<const unsigned char>& jsonChunk, std::span<const unsigned char>& binChunk);
+	void loadBuffers(std::span<const unsigned char> binChunk);
+	std::span<const unsigned char> getBuffer(const json& bufferView) const;
+	// Typed view of a tightly packed accessor (no byteStride, or one equal to the element
+	// size). Returns an empty span when the data is interleaved or out of range.
+	template<typename T>
+	std::span<const T> getAccessorSpan(const json& accessor, size_t componentsPerElement) const;
+	// First element of the accessor inside the mapped buffer, or nullptr if it has no
+	// bufferView or does not fit. byteStride defaults to elementSize when not given.
+	const unsigned char* getAccessorData(const json& accessor, size_t elementSize, size_t& byteStride, size_t& count) const;
+	// Decodes up to maxCount elements of any componentType (honouring byteStride and
+	// `normalized`) as floats into destination, advancing destinationStride bytes per
+	// element. Components beyond destinationComponents are dropped. Returns the count written.
+	size_t decodeAccessor(const json& accessor, void* destination, size_t destinationStride, unsigned int destinationComponents, size_t maxCount) const;
+	std::vector<GLuint> getIndices(const json& accessor) const;
+	void collectTextureRefs();
 	std::vector<Texture> getTextures();
+};
 
-	std::vector<Vertex> assembleVertices(
-		std::vector<glm::vec3> positions,
-		std::vector<glm::vec3> normals,
-		std::vector<glm::vec2> texUVs
-	);
+template<typename T>
+std::span<const T> Model::getAccessorSpan(const json& accessor, size_t componentsPerElement) const
+{
+	if (!accessor.contains("bufferView"))
+		return {};
 
-	std::vector<glm::vec2> groupFloatsVec2(std::vector<float> floatVec);
-	std::vector<glm::vec3> groupFloatsVec3(std::vector<float> floatVec);
-	std::vector<glm::vec4> groupFloatsVec4(std::vector<float> floatVec);
-};
+	const json& bufferView = JSON["bufferViews"][accessor["bufferView"].get<unsigned int>()];
+	const size_t elementSize = sizeof(T) * componentsPerElement;
+	const size_t byteStride = bufferView.value("byteStride", elementSize);
+	if (byteStride != elementSize)
+		return {};
+
+	const size_t begin = bufferView.value("byteOffset", size_t(0)) + accessor.value("byteOffset", size_t(0));
+	const size_t count = accessor["count"].get<size_t>() * componentsPerElement;
+	const std::span<const unsigned char> buffer = getBuffer(bufferView);
+	if (begin % alignof(T) != 0 || begin + count * sizeof(T) > buffer.size())
+		return {};
+
+	return { reinterpret_cast<const T*>(buffer.data() + begin), count };
+}
@@ -0,0 +1,88 @@
+#include "PackedVertex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/packing.hpp>
+
+namespace {
+    uint32_t packSnorm10(float value) {
+        const int quantized = static_cast<int>(std::round(std::clamp(value, -1.0f, 1.0f) * 511.0f));
+        return static_cast<uint32_t>(quantized) & 0x3FFu;
+    }
+
+    // x and y in the low 20 bits of GL_INT_2_10_10_10_REV; z is unused and w is 1.
+    uint32_t packOctahedral(glm::vec3 direction) {
+        const glm::vec2 encoded = encodeOctahedral(direction);
+        return packSnorm10(encoded.x) | (packSnorm10(encoded.y) << 10) | (0x1u << 30);
+    }
+
+    uint16_t packUnorm16(float value) {
+        return static_cast<uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+}
+
+glm::vec2 encodeOctahedral(glm::vec3 direction) {
+    const float l1 = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (l1 <= 0.0f) {
+        return glm::vec2(0.0f);
+    }
+
+    glm::vec2 encoded(direction.x / l1, direction.y / l1);
+    if (direction.z < 0.0f) {
+        const glm::vec2 folded(1.0f - std::abs(encoded.y), 1.0f - std::abs(encoded.x));
+        encoded.x = encoded.x >= 0.0f ? folded.x : -folded.x;
+        encoded.y = encoded.y >= 0.0f ? folded.y : -folded.y;
+    }
+    return encoded;
+}
+
+glm::vec3 decodeOctahedral(glm::vec2 encoded) {
+    glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    const float fold = std::max(-direction.z, 0.0f);
+    direction.x += direction.x >= 0.0f ? -fold : fold;
+    direction.y += direction.y >= 0.0f ? -fold : fold;
+    return glm::normalize(direction);
+}
+
+VertexQuantization computeVertexQuantization(const std::vector<Vertex>& vertices) {
+    VertexQuantization quantization;
+    if (vertices.empty()) {
+        return quantization;
+    }
+
+    glm::vec3 minimum = vertices[0].position;
+    glm::vec3 maximum = vertices[0].position;
+    for (const Vertex& vertex : vertices) {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+    }
+
+    // Flat axes get a unit scale so packing never divides by zero.
+    quantization.offset = minimum;
+    quantization.scale = maximum - minimum;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (quantization.scale[axis] <= 0.0f) {
+            quantization.scale[axis] = 1.0f;
+        }
+    }
+    return quantization;
+}
+
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization) {
+    std::vector<PackedVertex> packed(vertices.size());
+    const glm::vec3 inverseScale = 1.0f / quantization.scale;
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        const glm::vec3 unit = (vertex.position - quantization.offset) * inverseScale;
+        out.position[0] = packUnorm16(unit.x);
+        out.position[1] = packUnorm16(unit.y);
+        out.position[2] = packUnorm16(unit.z);
+        out.position[3] = 0;
+
+        out.normal = packOctahedral(vertex.normal);
+        out.texCoords = glm::packHalf2x16(vertex.texCoords);
+    }
+    return packed;
+}
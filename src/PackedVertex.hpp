@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Vertex.hpp"
+
+enum class VertexFormat {
+    Float,      // Vertex as is, 68 bytes
+    Quantized   // PackedVertex, 16 bytes
+};
+
+// GPU-only layout; the CPU copy of a mesh stays in Vertex for BVH building and picking.
+//  position  unorm16 x3 relative to the mesh bounds (w is padding)
+//  normal    octahedral snorm10 x2 in GL_INT_2_10_10_10_REV
+//  texCoords half x2
+// Colour is dropped (the importer always writes white), and so are tangent and
+// bitangent, which default.vert does not read.
+struct PackedVertex {
+    uint16_t position[4];
+    uint32_t normal;
+    uint32_t texCoords;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay tightly packed");
+
+// Dequantization: position = offset + unorm * scale.
+struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+VertexQuantization computeVertexQuantization(const std::vector<Vertex>& vertices);
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization);
+
+// The shader implements the inverse of encodeOctahedral.
+glm::vec2 encodeOctahedral(glm::vec3 direction);
+glm::vec3 decodeOctahedral(glm::vec2 encoded);
@@ -0,0 +1,252 @@
+#include "SceneBVH.hpp"
+#include <cmath>
+
+namespace {
+    constexpr int kTraversalStackSize = 128;
+
+    bool intersectNode(const LBVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEntry) {
+        const glm::vec3 t1 = (glm::vec3(node.aabbMinX, node.aabbMinY, node.aabbMinZ) - origin) * invDir;
+        const glm::vec3 t2 = (glm::vec3(node.aabbMaxX, node.aabbMaxY, node.aabbMaxZ) - origin) * invDir;
+        const glm::vec3 tNear = glm::min(t1, t2);
+        const glm::vec3 tFar = glm::max(t1, t2);
+        tEntry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        const float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+        return tEntry <= tExit;
+    }
+
+    // LIFO of node indices: a fixed array covers typical depths, deeper trees (LBVHs over
+    // clustered Morton codes can be) spill into a vector instead of dropping subtrees.
+    class TraversalStack {
+    public:
+        bool empty() const { return size == 0; }
+
+        void push(int node) {
+            if (size < kTraversalStackSize) {
+                fixed[size] = node;
+            }
+            else {
+                spill.push_back(node);
+            }
+            ++size;
+        }
+
+        int pop() {
+            --size;
+            if (size < kTraversalStackSize) {
+                return fixed[size];
+            }
+            const int node = spill.back();
+            spill.pop_back();
+            return node;
+        }
+
+    private:
+        int fixed[kTraversalStackSize];
+        std::vector<int> spill;
+        int size = 0;
+    };
+
+    glm::vec3 safeInverse(const glm::vec3& dir) {
+        return glm::vec3(
+            (std::abs(dir.x) > 1e-12f) ? 1.0f / dir.x : FLT_MAX,
+            (std::abs(dir.y) > 1e-12f) ? 1.0f / dir.y : FLT_MAX,
+            (std::abs(dir.z) > 1e-12f) ? 1.0f / dir.z : FLT_MAX);
+    }
+
+    // Visits leaves front to back; onLeaf(primitiveIdx) may shrink tMax to prune the rest.
+    template<typename LeafFn>
+    void traverse(const std::vector<LBVHNode>& nodes, const glm::vec3& origin, const glm::vec3& direction, float& tMax, LeafFn&& onLeaf) {
+        if (nodes.empty()) {
+            return;
+        }
+
+        const glm::vec3 invDir = safeInverse(direction);
+        TraversalStack stack;
+        float tEntry;
+
+        if (!intersectNode(nodes[0], origin, invDir, tMax, tEntry)) {
+            return;
+        }
+        stack.push(0);
+
+        while (!stack.empty()) {
+            const LBVHNode& node = nodes[stack.pop()];
+            if (node.left < 0) {
+                onLeaf(node.primitiveIdx);
+                continue;
+            }
+
+            float tLeft, tRight;
+            const bool hitLeft = intersectNode(nodes[node.left], origin, invDir, tMax, tLeft);
+            const bool hitRight = intersectNode(nodes[node.right], origin, invDir, tMax, tRight);
+
+            if (hitLeft && hitRight) {
+                // Push the far child first so the near one is popped next.
+                const bool leftFirst = tLeft <= tRight;
+                stack.push(leftFirst ? node.right : node.left);
+                stack.push(leftFirst ? node.left : node.right);
+            }
+            else if (hitLeft) {
+                stack.push(node.left);
+            }
+            else if (hitRight) {
+                stack.push(node.right);
+            }
+        }
+    }
+
+    bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+        const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t, float& u, float& v) {
+        const glm::vec3 edge1 = v1 - v0;
+        const glm::vec3 edge2 = v2 - v0;
+        const glm::vec3 pvec = glm::cross(direction, edge2);
+        const float det = glm::dot(edge1, pvec);
+        if (std::abs(det) < 1e-12f) {
+            return false;
+        }
+
+        const float invDet = 1.0f / det;
+        const glm::vec3 tvec = origin - v0;
+        u = glm::dot(tvec, pvec) * invDet;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+
+        const glm::vec3 qvec = glm::cross(tvec, edge1);
+        v = glm::dot(direction, qvec) * invDet;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+
+        t = glm::dot(edge2, qvec) * invDet;
+        return t > 1e-6f;
+    }
+}
+
+void SceneBVH::buildBLAS(const std::vector<Mesh>& meshes, const std::vector<std::span<const LBVHNode>>& prebuiltNodes) {
+    blas.clear();
+    blasTriangles.clear();
+    instances.clear();
+    tlas.m_bvh.clear();
+
+    std::vector<glm::vec3> positions;
+    size_t adopted = 0;
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        const Mesh& mesh = meshes[meshIndex];
+        auto meshBVH = std::make_unique<BVH>();
+        meshBVH->uploadVisualization = false;
+        // Built once and queried repeatedly, so spend the extra build time on tree quality.
+        meshBVH->buildQuality = BVHBuildQuality::BinnedSAH;
+
+        positions.clear();
+        positions.reserve(mesh.vertices.size());
+        for (const auto& vertex : mesh.vertices) {
+            positions.push_back(vertex.position);
+        }
+        const size_t numTris = mesh.indices.size() / 3;
+        if (meshIndex < prebuiltNodes.size() && numTris > 0 && prebuiltNodes[meshIndex].size() == 2 * numTris - 1) {
+            meshBVH->adoptNodes(std::vector<LBVHNode>(prebuiltNodes[meshIndex].begin(), prebuiltNodes[meshIndex].end()));
+            ++adopted;
+        }
+        else if (!mesh.indices.empty()) {
+            meshBVH->buildLBVHParallelCPU(positions, mesh.indices);
+        }
+
+        // Packed copies of the corners keep triangle tests off the fat Vertex array.
+        std::vector<glm::vec3> triangles;
+        if (!meshBVH->m_bvh.empty()) {
+            triangles.reserve(mesh.indices.size() / 3 * 3);
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                triangles.push_back(positions[mesh.indices[i]]);
+                triangles.push_back(positions[mesh.indices[i + 1]]);
+                triangles.push_back(positions[mesh.indices[i + 2]]);
+            }
+        }
+
+        blas.push_back(std::move(meshBVH));
+        blasTriangles.push_back(std::move(triangles));
+    }
+
+    MyglobalLogger().logMessage(Logger::INFO,
+        "Built " + std::to_string(blas.size()) + " mesh BLAS over " + std::to_string(getTriangleCount()) + " triangles (" +
+        std::to_string(adopted) + " from cache)",
+        __FILE__, __LINE__);
+}
+
+void SceneBVH::updateInstances(const std::vector<glm::mat4>& meshLocalMatrices, const glm::mat4& modelMatrix) {
+    instances.clear();
+    std::vector<AABB> instanceBounds;
+
+    for (uint32_t i = 0; i < blas.size(); ++i) {
+        if (blas[i]->m_bvh.empty()) {
+            continue;
+        }
+
+        const glm::mat4 meshLocal = (i < meshLocalMatrices.size()) ? meshLocalMatrices[i] : glm::mat4(1.0f);
+        BVHInstance instance;
+        instance.meshIndex = i;
+        instance.transform = modelMatrix * meshLocal;
+        instance.inverseTransform = glm::inverse(instance.transform);
+
+        const LBVHNode& root = blas[i]->m_bvh[0];
+        const glm::vec3 localMin(root.aabbMinX, root.aabbMinY, root.aabbMinZ);
+        const glm::vec3 localMax(root.aabbMaxX, root.aabbMaxY, root.aabbMaxZ);
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec3 point((corner & 1) ? localMax.x : localMin.x,
+                (corner & 2) ? localMax.y : localMin.y,
+                (corner & 4) ? localMax.z : localMin.z);
+            instance.worldBounds.expand(glm::vec3(instance.transform * glm::vec4(point, 1.0f)));
+        }
+
+        instances.push_back(instance);
+        instanceBounds.push_back(instance.worldBounds);
+    }
+
+    tlas.buildLBVHFromBounds(instanceBounds);
+}
+
+bool SceneBVH::intersect(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const {
+    hit = RayHit{};
+    float closest = FLT_MAX;
+
+    traverse(tlas.m_bvh, origin, direction, closest, [&](uint32_t instanceIdx) {
+        if (instanceIdx >= instances.size()) {
+            return;
+        }
+        const BVHInstance& instance = instances[instanceIdx];
+        const std::vector<glm::vec3>& triangles = blasTriangles[instance.meshIndex];
+
+        // An affine transform keeps the ray parameter, so local t is directly comparable.
+        const glm::vec3 localOrigin = glm::vec3(instance.inverseTransform * glm::vec4(origin, 1.0f));
+        const glm::vec3 localDirection = glm::vec3(instance.inverseTransform * glm::vec4(direction, 0.0f));
+
+        traverse(blas[instance.meshIndex]->m_bvh, localOrigin, localDirection, closest, [&](uint32_t tri) {
+            if (static_cast<size_t>(tri) * 3 + 2 >= triangles.size()) {
+                return;
+            }
+            float t, u, v;
+            if (intersectTriangle(localOrigin, localDirection, triangles[tri * 3], triangles[tri * 3 + 1], triangles[tri * 3 + 2], t, u, v) &&
+                t < closest) {
+                closest = t;
+                hit.hit = true;
+                hit.meshIndex = instance.meshIndex;
+                hit.triangleIndex = tri;
+                hit.barycentrics = glm::vec2(u, v);
+            }
+        });
+    });
+
+    if (hit.hit) {
+        hit.distance = closest * glm::length(direction);
+    }
+    return hit.hit;
+}
+
+size_t SceneBVH::getTriangleCount() const {
+    size_t count = 0;
+    // Adopted trees keep no primitives; the packed corners exist either way.
+    for (const auto& triangles : blasTriangles) {
+        count += triangles.size() / 3;
+    }
+    return count;
+}
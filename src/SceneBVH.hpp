@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "LBVH.hpp"
+#include "Mesh.hpp"
+
+struct BVHInstance {
+    uint32_t meshIndex;
+    glm::mat4 transform;
+    glm::mat4 inverseTransform;
+    AABB worldBounds;
+};
+
+struct RayHit {
+    bool hit = false;
+    uint32_t meshIndex = 0;
+    uint32_t triangleIndex = 0;
+    glm::vec2 barycentrics = glm::vec2(0.0f); // weights of the triangle's second and third vertex
+    float distance = FLT_MAX;
+};
+
+// Two-level acceleration structure: one BVH per Mesh over its triangles in mesh-local
+// space (built once per model load) and a top-level BVH over the world bounds of the
+// mesh instances. Moving the model only rebuilds the TLAS.
+class SceneBVH {
+public:
+    std::vector<std::unique_ptr<BVH>> blas;
+    std::vector<std::vector<glm::vec3>> blasTriangles; // three mesh-local corners per triangle
+    std::vector<BVHInstance> instances;
+    BVH tlas;
+
+    SceneBVH() { tlas.uploadVisualization = false; }
+
+    // prebuiltNodes[i], when it matches mesh i's triangle count, is adopted instead of building.
+    void buildBLAS(const std::vector<Mesh>& meshes, const std::vector<std::span<const LBVHNode>>& prebuiltNodes = {});
+    void updateInstances(const std::vector<glm::mat4>& meshLocalMatrices, const glm::mat4& modelMatrix);
+
+    // Closest hit of a world-space ray: TLAS slab traversal, then the hit instances' BLAS
+    // in mesh-local space with Moller-Trumbore triangle tests.
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const;
+
+    bool empty() const { return tlas.m_bvh.empty(); }
+    size_t getTriangleCount() const;
+};
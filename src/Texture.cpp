@@ -1,4 +1,5 @@
 #include "Texture.hpp"
+#include "CompressedTexture.hpp"
 #include <iostream>
 #include <filesystem>
 #include <cstring>
@@ -47,8 +48,13 @@ Texture::Texture(const char* image, GLenum texType, GLuint slot, GLenum format,
         glTexParameteri(texType, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(texType, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        glTexImage2D(texType, 0, internalFormat, widthImg, heightImg, 0, dataFormat, pixelType, bytes);
-        glGenerateMipmap(texType);
+        if (pixelType == GL_UNSIGNED_BYTE) {
+            uploadWithMips(texType, internalFormat, dataFormat, bytes, widthImg, heightImg, 1, numColch);
+        }
+        else {
+            glTexImage2D(texType, 0, internalFormat, widthImg, heightImg, 0, dataFormat, pixelType, bytes);
+            glGenerateMipmap(texType);
+        }
 
         stbi_image_free(bytes);
         glBindTexture(texType, 0);
@@ -91,6 +97,19 @@ Texture::Texture(const char* pathFile, const char* directory, const char* typeNa
     ID = TextureFromFile(filename.c_str(), "", false);
 }
 
+Texture::Texture(TextureCache::Handle handle, const char* typeName, GLuint textureUnit) {
+    type = GL_TEXTURE_2D;
+    unit = textureUnit;
+    ID = handle ? handle->id : 0;
+    cacheHandle = std::move(handle);
+
+    strncpy(path, cacheHandle ? cacheHandle->path.c_str() : "", sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+
+    strncpy(type_r, typeName, sizeof(type_r) - 1);
+    type_r[sizeof(type_r) - 1] = '\0';
+}
+
 void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit) {
     GLuint textUnit = glGetUniformLocation(shader.ID, uniform);
     shader.use();
@@ -124,8 +143,7 @@ unsigned int Texture::TextureFromFile(const char* path, const std::string& direc
         }
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        uploadWithMips(GL_TEXTURE_2D, format, format, data, width, height, 1, nrComponents, { .srgb = gamma });
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -142,6 +160,129 @@ unsigned int Texture::TextureFromFile(const char* path, const std::string& direc
     return textureID;
 }
 
+bool Texture::hasImmutableStorage() {
+    return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+}
+
+GLenum Texture::sizedInternalFormat(int channels) {
+    switch (channels) {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 3: return GL_RGB8;
+    default: return GL_RGBA8;
+    }
+}
+
+int Texture::uploadWithMips(GLenum target, GLint internalFormat, GLenum dataFormat, const unsigned char* pixels, int width, int height, int depth, int channels, const MipOptions& options) {
+    const std::vector<MipLevel> mips = MipGenerator::build(pixels, width, height, depth, channels, options);
+    const GLsizei levelCount = static_cast<GLsizei>(mips.size()) + 1;
+    const bool immutable = hasImmutableStorage();
+    if (immutable && target == GL_TEXTURE_3D) {
+        glTexStorage3D(target, levelCount, sizedInternalFormat(channels), width, height, depth);
+    }
+    else if (immutable) {
+        glTexStorage2D(target, levelCount, sizedInternalFormat(channels), width, height);
+    }
+
+    // Small levels of RGB images have rows that are not 4-byte multiples.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i <= mips.size(); ++i) {
+        const unsigned char* data = i == 0 ? pixels : mips[i - 1].pixels.data();
+        const int levelWidth = i == 0 ? width : mips[i - 1].width;
+        const int levelHeight = i == 0 ? height : mips[i - 1].height;
+        const int levelDepth = i == 0 ? depth : mips[i - 1].depth;
+        const GLint level = static_cast<GLint>(i);
+        if (target == GL_TEXTURE_3D && immutable) {
+            glTexSubImage3D(target, level, 0, 0, 0, levelWidth, levelHeight, levelDepth, dataFormat, GL_UNSIGNED_BYTE, data);
+        }
+        else if (target == GL_TEXTURE_3D) {
+            glTexImage3D(target, level, internalFormat, levelWidth, levelHeight, levelDepth, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+        }
+        else if (immutable) {
+            glTexSubImage2D(target, level, 0, 0, levelWidth, levelHeight, dataFormat, GL_UNSIGNED_BYTE, data);
+        }
+        else {
+            glTexImage2D(target, level, internalFormat, levelWidth, levelHeight, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    return levelCount;
+}
+
+GLenum Texture::compressedInternalFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+bool Texture::supportsCompressedFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3: return GLEW_EXT_texture_compression_s3tc;
+    case BlockFormat::BC5: return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+    default: return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    }
+}
+
+unsigned int Texture::TextureFromCompressed(const CompressedTexture& image) {
+    const std::vector<CompressedLevel>& levels = image.getLevels();
+    if (levels.empty()) {
+        return 0;
+    }
+    if (!supportsCompressedFormat(image.getFormat())) {
+        std::cerr << "Compressed texture format BC" << static_cast<uint32_t>(image.getFormat()) << " is not supported by the driver" << std::endl;
+        return 0;
+    }
+
+    const GLenum target = levels[0].depth > 1 ? GL_TEXTURE_3D : GL_TEXTURE_2D;
+    const GLenum internalFormat = compressedInternalFormat(image.getFormat());
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(target, textureID);
+    const bool immutable = hasImmutableStorage();
+    if (immutable && target == GL_TEXTURE_3D) {
+        glTexStorage3D(target, static_cast<GLsizei>(levels.size()), internalFormat, levels[0].width, levels[0].height, levels[0].depth);
+    }
+    else if (immutable) {
+        glTexStorage2D(target, static_cast<GLsizei>(levels.size()), internalFormat, levels[0].width, levels[0].height);
+    }
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const CompressedLevel& level = levels[i];
+        const GLint index = static_cast<GLint>(i);
+        const GLsizei bytes = static_cast<GLsizei>(level.blocks.size());
+        if (target == GL_TEXTURE_3D && immutable) {
+            glCompressedTexSubImage3D(target, index, 0, 0, 0, level.width, level.height, level.depth, internalFormat, bytes, level.blocks.data());
+        }
+        else if (target == GL_TEXTURE_3D) {
+            glCompressedTexImage3D(target, index, internalFormat, level.width, level.height, level.depth, 0, bytes, level.blocks.data());
+        }
+        else if (immutable) {
+            glCompressedTexSubImage2D(target, index, 0, 0, level.width, level.height, internalFormat, bytes, level.blocks.data());
+        }
+        else {
+            glCompressedTexImage2D(target, index, internalFormat, level.width, level.height, 0, bytes, level.blocks.data());
+        }
+    }
+
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (image.getFormat() == BlockFormat::BC5 && image.getSourceChannels() == 2) {
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    glBindTexture(target, 0);
+    return textureID;
+}
+
 unsigned int Texture::loadCubemap(std::vector<std::string> faces) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
@@ -3,7 +3,12 @@
 #include <string>
 #include <vector>
 #include <cstring>
+#include "MipGenerator.hpp"
 #include "Shader.hpp"
+#include "TextureCache.hpp"
+
+class CompressedTexture;
+enum class BlockFormat : uint32_t;
 
 class Texture {
 public:
@@ -12,6 +17,8 @@ public:
     GLuint unit;
     char path[256];
     char type_r[64];
+    // Set for textures from the TextureCache, which owns the name; copies share it.
+    TextureCache::Handle cacheHandle;
 
 public:
     Texture() : ID(0), type(GL_TEXTURE_2D), unit(0) {
@@ -25,12 +32,14 @@ public:
 
     Texture(const char* pathFile, const char* directory, const char* typeName);
 
+    Texture(TextureCache::Handle handle, const char* typeName, GLuint textureUnit);
+
     ~Texture() {
         deleteTexture();
     }
 
     Texture(const Texture& other)
-        : ID(0), type(other.type), unit(other.unit) {
+        : ID(0), type(other.type), unit(other.unit), cacheHandle(other.cacheHandle) {
         std::strcpy(path, other.path);
         std::strcpy(type_r, other.type_r);
 
@@ -42,6 +51,7 @@ public:
             ID = other.ID;
             type = other.type;
             unit = other.unit;
+            cacheHandle = other.cacheHandle;
             std::strcpy(path, other.path);
             std::strcpy(type_r, other.type_r);
         }
@@ -49,7 +59,7 @@ public:
     }
 
     Texture(Texture&& other) noexcept
-        : ID(other.ID), type(other.type), unit(other.unit) {
+        : ID(other.ID), type(other.type), unit(other.unit), cacheHandle(std::move(other.cacheHandle)) {
         std::strcpy(path, other.path);
         std::strcpy(type_r, other.type_r);
         other.ID = 0;
@@ -63,6 +73,7 @@ public:
             ID = other.ID;
             type = other.type;
             unit = other.unit;
+            cacheHandle = std::move(other.cacheHandle);
             std::strcpy(path, other.path);
             std::strcpy(type_r, other.type_r);
             other.ID = 0;
@@ -77,13 +88,32 @@ public:
     void bind();
     void unbind();
     void deleteTexture() {  
-        if (ID != 0) {
+        if (cacheHandle) {
+            cacheHandle.reset();
+            ID = 0;
+        }
+        else if (ID != 0) {
             glDeleteTextures(1, &ID);
             ID = 0;
         }
     }
 
+    // gamma marks the image as sRGB colour, which its mips are averaged for.
     static unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+    // glTexStorage (GL 4.2): loaders allocate every level at once as immutable storage,
+    // which bindless handles and image copies into material arrays rely on.
+    static bool hasImmutableStorage();
+    static GLenum sizedInternalFormat(int channels);
+    // Uploads 8-bit pixels as level 0 of the bound 2D or 3D target followed by a CPU-built
+    // MipGenerator chain, and caps GL_TEXTURE_MAX_LEVEL at it. Returns the level count.
+    static int uploadWithMips(GLenum target, GLint internalFormat, GLenum dataFormat, const unsigned char* pixels,
+        int width, int height, int depth, int channels, const MipOptions& options = {});
+    // Uploads every level of an open CompressedTexture, as a 3D texture when it is a
+    // volume. Returns 0 when the driver lacks the format.
+    static unsigned int TextureFromCompressed(const CompressedTexture& image);
+    static GLenum compressedInternalFormat(BlockFormat format);
+    // Whether the driver exposes the extension or core version that format needs.
+    static bool supportsCompressedFormat(BlockFormat format);
     static unsigned int loadCubemap(std::vector<std::string> faces);
     static unsigned int Texture2D(int w, int h);
     static unsigned int Texture3D(int w, int h, int d);
@@ -0,0 +1,180 @@
+#include "TextureCache.hpp"
+#include <algorithm>
+#include <filesystem>
+#include "CompressedTexture.hpp"
+#include "MappedFile.hpp"
+#include "Texture.hpp"
+#include "TextureStreamer.hpp"
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    std::string canonicalPath(const std::string& path) {
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        return error ? path : canonical.generic_string();
+    }
+
+    // Level 0 as the driver reports it, plus a third for the mip chain.
+    size_t textureBytes(GLuint id) {
+        GLint width = 0, height = 0, bits = 0;
+        glBindTexture(GL_TEXTURE_2D, id);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        for (GLenum channel : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE }) {
+            GLint channelBits = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, channel, &channelBits);
+            bits += channelBits;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        const size_t levelBytes = static_cast<size_t>(width) * height * bits / 8;
+        return levelBytes + levelBytes / 3;
+    }
+}
+
+TextureCache::~TextureCache() {
+    release();
+}
+
+TextureCache::Handle TextureCache::acquire(const std::string& path, bool stream, bool compress, bool srgb) {
+    const std::string key = canonicalPath(path);
+    if (auto found = byPath.find(key); found != byPath.end()) {
+        stats.hits++;
+        found->second->lastUse = ++useCounter;
+        return found->second->shared_from_this();
+    }
+
+    uint64_t contentHash = 0;
+    uint64_t fileSize = 0;
+    if (contentHashing) {
+        std::error_code error;
+        fileSize = std::filesystem::file_size(key, error);
+        if (error) {
+            fileSize = 0;
+        }
+        else if (Entry* found = findContent(key, fileSize, contentHash)) {
+            stats.hits++;
+            found->lastUse = ++useCounter;
+            byPath[key] = found;
+            return found->shared_from_this();
+        }
+    }
+
+    stats.misses++;
+    auto entry = std::make_shared<Entry>();
+    entry->path = key;
+    entry->contentHash = contentHash;
+    entry->fileSize = fileSize;
+    entry->lastUse = ++useCounter;
+    if (stream) {
+        std::weak_ptr<Entry> weak = entry;
+        entry->id = globalTextureStreamer().request(key, compress, srgb, [this, weak](size_t bytes) {
+            if (std::shared_ptr<Entry> streamed = weak.lock()) {
+                stats.residentBytes += bytes;
+                streamed->bytes = bytes;
+                streamed->resident = true;
+            }
+        });
+    }
+    else {
+        CompressedTexture compressed;
+        if (compress && compressed.openOrImport(key, { .srgb = srgb })) {
+            entry->id = Texture::TextureFromCompressed(compressed);
+            entry->bytes = compressed.getByteSize();
+        }
+        if (entry->id == 0) {
+            entry->id = Texture::TextureFromFile(key.c_str(), "", srgb);
+            entry->bytes = entry->id != 0 ? textureBytes(entry->id) : 0;
+        }
+        if (entry->id == 0) {
+            return nullptr;
+        }
+        entry->resident = true;
+        stats.residentBytes += entry->bytes;
+    }
+
+    byPath[key] = entry.get();
+    if (contentHashing && fileSize != 0) {
+        bySize.emplace(fileSize, entry.get());
+    }
+    entries.push_back(entry);
+    stats.entries = entries.size();
+    trim();
+    return entry;
+}
+
+TextureCache::Entry* TextureCache::findContent(const std::string& path, uint64_t fileSize, uint64_t& contentHash) {
+    auto [first, last] = bySize.equal_range(fileSize);
+    if (first == last) {
+        return nullptr;
+    }
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return nullptr;
+    }
+    contentHash = hashBytes(file.bytes());
+    for (auto it = first; it != last; ++it) {
+        Entry* candidate = it->second;
+        if (candidate->contentHash == 0) {
+            MappedFile other(candidate->path);
+            if (!other.isOpen()) {
+                continue;
+            }
+            candidate->contentHash = hashBytes(other.bytes());
+        }
+        if (candidate->contentHash == contentHash) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+void TextureCache::trim() {
+    if (stats.residentBytes <= budget) {
+        return;
+    }
+
+    std::vector<Entry*> unused;
+    for (const std::shared_ptr<Entry>& entry : entries) {
+        if (entry.use_count() == 1 && entry->resident) {
+            unused.push_back(entry.get());
+        }
+    }
+    std::sort(unused.begin(), unused.end(), [](const Entry* a, const Entry* b) { return a->lastUse < b->lastUse; });
+    for (Entry* entry : unused) {
+        if (stats.residentBytes <= budget) {
+            break;
+        }
+        MyglobalLogger().logMessage(Logger::INFO, "Texture cache evicted " + entry->path, __FILE__, __LINE__);
+        evict(entry);
+    }
+}
+
+void TextureCache::evict(Entry* entry) {
+    glDeleteTextures(1, &entry->id);
+    stats.residentBytes -= entry->bytes;
+    stats.evictions++;
+    std::erase_if(byPath, [entry](const auto& item) { return item.second == entry; });
+    std::erase_if(bySize, [entry](const auto& item) { return item.second == entry; });
+    std::erase_if(entries, [entry](const std::shared_ptr<Entry>& item) { return item.get() == entry; });
+    stats.entries = entries.size();
+}
+
+void TextureCache::release() {
+    for (const std::shared_ptr<Entry>& entry : entries) {
+        if (entry->id != 0) {
+            glDeleteTextures(1, &entry->id);
+            entry->id = 0;
+        }
+    }
+    entries.clear();
+    byPath.clear();
+    bySize.clear();
+    stats.entries = 0;
+    stats.residentBytes = 0;
+}
+
+TextureCache& globalTextureCache() {
+    static TextureCache cache;
+    return cache;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <gl/glew.h>
+
+// Process-wide cache of image textures, so models referencing the same file share one
+// GL texture instead of decoding and uploading it again. Entries are keyed by canonical
+// path and, with content hashing on, by file size and content hash so copies stored
+// under other paths hit as well. Files are only hashed once another entry has the same
+// size, so a miss costs one stat rather than a read of the image. acquire() returns a shared handle; an entry nobody holds stays
+// cached until the resident bytes exceed the VRAM budget, then trim() deletes unused
+// entries, least recently acquired first. Context thread only.
+class TextureCache {
+public:
+    struct Entry : std::enable_shared_from_this<Entry> {
+        GLuint id = 0;
+        std::string path;
+        // Hashed lazily, when a file of the same size is acquired; 0 until then.
+        uint64_t contentHash = 0;
+        uint64_t fileSize = 0;
+        size_t bytes = 0;
+        // False while the streamer still uploads into the name; such entries are kept.
+        bool resident = false;
+        uint64_t lastUse = 0;
+    };
+    using Handle = std::shared_ptr<const Entry>;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t residentBytes = 0;
+    };
+
+    static constexpr size_t kDefaultBudget = 512u << 20;
+
+    TextureCache() = default;
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Null when the file cannot be loaded. stream hands misses to globalTextureStreamer();
+    // compress loads them through their CompressedTexture cache, importing it if needed.
+    // srgb marks colour images, whose mips are averaged in linear light; the first
+    // acquire of a file decides.
+    Handle acquire(const std::string& path, bool stream, bool compress = false, bool srgb = false);
+    // Evicts unused entries until the resident bytes fit the budget; cheap when they do.
+    void trim();
+    // Deletes every texture; call before the context goes away. Outstanding handles
+    // stay valid as objects but name nothing.
+    void release();
+
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+    // Applies to later acquires; ModelLoadOptions::hashTextureContent sets it per load.
+    void setContentHashing(bool enabled) { contentHashing = enabled; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    void evict(Entry* entry);
+    // An entry holding the same bytes as the file at path, or null. Hashes the file and
+    // any same-sized entries not hashed yet.
+    Entry* findContent(const std::string& path, uint64_t fileSize, uint64_t& contentHash);
+
+    // One strong reference each; a use count of one means no Texture holds the entry.
+    std::vector<std::shared_ptr<Entry>> entries;
+    std::unordered_map<std::string, Entry*> byPath;
+    std::unordered_multimap<uint64_t, Entry*> bySize;
+    size_t budget = kDefaultBudget;
+    bool contentHashing = false;
+    uint64_t useCounter = 0;
+    Stats stats;
+};
+
+TextureCache& globalTextureCache();
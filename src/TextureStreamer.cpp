@@ -0,0 +1,287 @@
+#include "TextureStreamer.hpp"
+#include <algorithm>
+#include <cstring>
+#include "Texture.hpp"
+#include "../../libraries/stb/stb_image.hpp"
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    GLenum pixelFormat(int channels) {
+        switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+        }
+    }
+}
+
+TextureStreamer::TextureStreamer(ThreadPool& pool) : pool(pool), ring(kRingSlots) {
+}
+
+TextureStreamer::~TextureStreamer() {
+    release();
+}
+
+GLuint TextureStreamer::request(const std::string& path, bool compress, bool srgb, std::function<void(size_t bytes)> onDone) {
+    static const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->inFlight++;
+    }
+    pool.submit([queue = queue, path, texture, compress, srgb, onDone = std::move(onDone)]() mutable {
+        DecodedImage image;
+        image.texture = texture;
+        image.path = path;
+        image.onDone = std::move(onDone);
+        if (compress) {
+            auto cached = std::make_unique<CompressedTexture>();
+            // Unsupported block formats fall back to the uncompressed path below.
+            if (cached->openOrImport(path, { .srgb = srgb }) && Texture::supportsCompressedFormat(cached->getFormat())) {
+                image.width = static_cast<int>(cached->getLevels()[0].width);
+                image.height = static_cast<int>(cached->getLevels()[0].height);
+                image.compressed = std::move(cached);
+            }
+        }
+        if (!image.compressed) {
+            stbi_set_flip_vertically_on_load_thread(true);
+            image.pixels = { stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0), stbi_image_free };
+            image.mips = MipGenerator::build(image.pixels.get(), image.width, image.height, 1, image.channels, { .srgb = srgb });
+        }
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->finished.push_back(std::move(image));
+        queue->inFlight--;
+    });
+    return texture;
+}
+
+void TextureStreamer::update() {
+    lastFrameBytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        for (DecodedImage& image : queue->finished) {
+            uploads.push_back(std::move(image));
+        }
+        queue->finished.clear();
+    }
+
+    while (!uploads.empty()) {
+        DecodedImage& image = uploads.front();
+        if (!image.pixels && !image.compressed) {
+            MyglobalLogger().logMessage(Logger::WARNING, "Texture failed to load at path: " + image.path + ", keeping placeholder", __FILE__, __LINE__);
+            if (image.onDone) {
+                image.onDone(4);
+            }
+            uploads.pop_front();
+            continue;
+        }
+
+        // At least one slice per frame, so an image larger than the budget still lands.
+        const size_t remaining = frameBudget > lastFrameBytes ? frameBudget - lastFrameBytes : 0;
+        if (remaining == 0 && lastFrameBytes > 0) {
+            break;
+        }
+        if (image.level == 0 && image.nextRow == 0) {
+            allocateLevels(image);
+        }
+
+        const size_t sent = uploadSlice(image, remaining);
+        if (sent == 0) {
+            break;
+        }
+        lastFrameBytes += sent;
+        if (image.level == levelCount(image)) {
+            finishImage(image);
+            uploads.pop_front();
+        }
+    }
+}
+
+size_t TextureStreamer::levelCount(const DecodedImage& image) {
+    return image.compressed ? image.compressed->getLevels().size() : image.mips.size() + 1;
+}
+
+void TextureStreamer::allocateLevels(const DecodedImage& image) {
+    glBindTexture(GL_TEXTURE_2D, image.texture);
+    // Level 0 only until the last slice; sampling stays complete meanwhile.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    // The placeholder was specified mutably, so the name may still take immutable storage.
+    const bool immutable = Texture::hasImmutableStorage();
+    if (image.compressed) {
+        const GLenum format = Texture::compressedInternalFormat(image.compressed->getFormat());
+        const std::vector<CompressedLevel>& levels = image.compressed->getLevels();
+        if (immutable) {
+            glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(levels.size()), format, levels[0].width, levels[0].height);
+        }
+        else {
+            for (size_t i = 0; i < levels.size(); ++i) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format, levels[i].width, levels[i].height, 0,
+                    static_cast<GLsizei>(levels[i].blocks.size()), nullptr);
+            }
+        }
+        if (image.compressed->getFormat() == BlockFormat::BC5 && image.compressed->getSourceChannels() == 2) {
+            const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+    }
+    else if (immutable) {
+        glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(levelCount(image)), Texture::sizedInternalFormat(image.channels), image.width, image.height);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, 0, Texture::sizedInternalFormat(image.channels), image.width, image.height, 0,
+            pixelFormat(image.channels), GL_UNSIGNED_BYTE, nullptr);
+        for (size_t i = 0; i < image.mips.size(); ++i) {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), Texture::sizedInternalFormat(image.channels), image.mips[i].width, image.mips[i].height, 0,
+                pixelFormat(image.channels), GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool TextureStreamer::acquireSlot(RingSlot& slot, size_t bytes) {
+    if (slot.fence) {
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    if (slot.buffer == 0) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    // Only a row wider than kSlotBytes grows a slot past the default size.
+    if (slot.capacity < bytes) {
+        slot.capacity = std::max(bytes, kSlotBytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    return true;
+}
+
+size_t TextureStreamer::uploadSlice(DecodedImage& image, size_t maxBytes) {
+    // A slice is a run of pixel rows, or of 4-row block rows in a compressed level.
+    int levelWidth = image.width;
+    int levelHeight = image.height;
+    int unitRows = 1;
+    const unsigned char* levelData = image.pixels.get();
+    if (image.level > 0 && !image.compressed) {
+        const MipLevel& level = image.mips[image.level - 1];
+        levelWidth = level.width;
+        levelHeight = level.height;
+        levelData = level.pixels.data();
+    }
+    size_t unitBytes = static_cast<size_t>(levelWidth) * image.channels;
+    if (image.compressed) {
+        const CompressedLevel& level = image.compressed->getLevels()[image.level];
+        levelWidth = static_cast<int>(level.width);
+        levelHeight = static_cast<int>(level.height);
+        unitRows = 4;
+        unitBytes = BlockCompressor::imageBytes(image.compressed->getFormat(), levelWidth, 1);
+        levelData = level.blocks.data();
+    }
+    const size_t maxUnits = std::max<size_t>(1, std::min(maxBytes, kSlotBytes) / unitBytes);
+    const size_t units = std::min<size_t>(maxUnits, (levelHeight - image.nextRow + unitRows - 1) / unitRows);
+    const int rows = std::min(static_cast<int>(units) * unitRows, levelHeight - image.nextRow);
+    const size_t bytes = unitBytes * units;
+
+    RingSlot& slot = ring[nextSlot];
+    if (!acquireSlot(slot, bytes)) {
+        return 0;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    // The slot's fence has passed, so nothing still reads the previous contents.
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+    std::memcpy(mapped, levelData + unitBytes * (image.nextRow / unitRows), bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, image.texture);
+    if (image.compressed) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(image.level), 0, image.nextRow, levelWidth, rows,
+            Texture::compressedInternalFormat(image.compressed->getFormat()), static_cast<GLsizei>(bytes), nullptr);
+    }
+    else {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(image.level), 0, image.nextRow, levelWidth, rows, pixelFormat(image.channels), GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextSlot = (nextSlot + 1) % ring.size();
+    image.nextRow += rows;
+    if (image.nextRow == levelHeight) {
+        image.level++;
+        image.nextRow = 0;
+    }
+    return bytes;
+}
+
+void TextureStreamer::finishImage(DecodedImage& image) {
+    // Every level came from the worker or the cache; sampling may now use them all.
+    const size_t levels = levelCount(image);
+    size_t bytes = 0;
+    if (image.compressed) {
+        bytes = image.compressed->getByteSize();
+    }
+    else {
+        bytes = static_cast<size_t>(image.width) * image.height * image.channels;
+        for (const MipLevel& level : image.mips) {
+            bytes += level.pixels.size();
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, image.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    residentCount++;
+    if (image.onDone) {
+        image.onDone(bytes);
+    }
+}
+
+void TextureStreamer::release() {
+    for (RingSlot& slot : ring) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        if (slot.buffer != 0) {
+            glDeleteBuffers(1, &slot.buffer);
+            slot.buffer = 0;
+            slot.capacity = 0;
+        }
+    }
+    uploads.clear();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->finished.clear();
+}
+
+size_t TextureStreamer::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->inFlight + queue->finished.size() + uploads.size();
+}
+
+TextureStreamer& globalTextureStreamer() {
+    static TextureStreamer streamer;
+    return streamer;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+#include "CompressedTexture.hpp"
+#include "MipGenerator.hpp"
+#include "ThreadPool.hpp"
+
+// Loads image files without stalling the GL thread. request() returns a texture name at
+// once, holding a 1x1 placeholder; a pool worker decodes the file and update(), called
+// once per frame on the context thread, streams the pixels in through a ring of pixel
+// unpack buffers. Large images are split into row slices so no frame uploads more than
+// the byte budget. The name never changes, so Texture copies made before the upload
+// finish pick up the real image automatically. The worker also builds the mip chain,
+// which is streamed after level 0. Compressed requests go through the file's
+// CompressedTexture cache instead, importing it on the worker when needed, and stream
+// its block rows level by level.
+class TextureStreamer {
+public:
+    static constexpr size_t kRingSlots = 8;
+    static constexpr size_t kSlotBytes = 4u << 20;
+    static constexpr size_t kDefaultFrameBudget = 16u << 20;
+
+    explicit TextureStreamer(ThreadPool& pool = globalThreadPool());
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // onDone runs on the context thread once the streamer stops touching the name, with
+    // the bytes it now occupies (the placeholder's when decoding failed). srgb marks colour
+    // images, whose mips are averaged in linear light.
+    GLuint request(const std::string& path, bool compress = false, bool srgb = false, std::function<void(size_t bytes)> onDone = {});
+    void update();
+    // Frees the GL objects; call before the context goes away. Decodes still running
+    // finish on their own and are dropped.
+    void release();
+
+    void setFrameBudget(size_t bytes) { frameBudget = bytes; }
+    size_t getFrameBudget() const { return frameBudget; }
+    size_t getPendingCount() const;
+    size_t getResidentCount() const { return residentCount; }
+    size_t getLastFrameBytes() const { return lastFrameBytes; }
+
+private:
+    struct DecodedImage {
+        GLuint texture = 0;
+        std::string path;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        std::unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, nullptr };
+        std::vector<MipLevel> mips;
+        // Set instead of pixels when the image comes from its block-compressed cache.
+        std::unique_ptr<CompressedTexture> compressed;
+        size_t level = 0;
+        int nextRow = 0;
+        std::function<void(size_t)> onDone;
+    };
+
+    // Shared with the decode tasks, which may outlive the streamer.
+    struct DecodeQueue {
+        std::mutex mutex;
+        std::vector<DecodedImage> finished;
+        size_t inFlight = 0;
+    };
+
+    struct RingSlot {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+    };
+
+    static size_t levelCount(const DecodedImage& image);
+    void allocateLevels(const DecodedImage& image);
+    bool acquireSlot(RingSlot& slot, size_t bytes);
+    // Uploads the next rows of image; returns the bytes sent, 0 when the ring is busy.
+    size_t uploadSlice(DecodedImage& image, size_t maxBytes);
+    void finishImage(DecodedImage& image);
+
+    ThreadPool& pool;
+    std::shared_ptr<DecodeQueue> queue = std::make_shared<DecodeQueue>();
+    std::deque<DecodedImage> uploads;
+    std::vector<RingSlot> ring;
+    size_t nextSlot = 0;
+    size_t frameBudget = kDefaultFrameBudget;
+    size_t residentCount = 0;
+    size_t lastFrameBytes = 0;
+};
+
+TextureStreamer& globalTextureStreamer();
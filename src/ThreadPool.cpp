@@ -0,0 +1,89 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace {
+    thread_local bool tlsIsPoolWorker = false;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    // The calling thread always takes a share of parallelFor work, so spawn one fewer.
+    const unsigned int workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool ThreadPool::isWorkerThread() {
+    return tlsIsPoolWorker;
+}
+
+void ThreadPool::workerLoop() {
+    tlsIsPoolWorker = true;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body, size_t minChunk) {
+    if (end <= begin) {
+        return;
+    }
+
+    const size_t count = end - begin;
+    minChunk = std::max<size_t>(minChunk, 1);
+    const size_t maxChunks = (count + minChunk - 1) / minChunk;
+    const size_t chunkCount = std::min<size_t>(maxChunks, getThreadCount());
+
+    if (chunkCount <= 1 || isWorkerThread()) {
+        body(begin, end);
+        return;
+    }
+
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::vector<std::future<void>> pending;
+    pending.reserve(chunkCount - 1);
+
+    for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+        const size_t chunkBegin = begin + chunk * chunkSize;
+        const size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+        if (chunkBegin >= chunkEnd) {
+            break;
+        }
+        pending.push_back(submit([&body, chunkBegin, chunkEnd]() { body(chunkBegin, chunkEnd); }));
+    }
+
+    body(begin, std::min(end, begin + chunkSize));
+
+    for (auto& future : pending) {
+        future.get();
+    }
+}
+
+ThreadPool& globalThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+    template<typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        if (workers.empty()) {
+            (*packaged)();
+            return future;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        queueCondition.notify_one();
+        return future;
+    }
+
+    // Splits [begin, end) into contiguous chunks of at least minChunk items and runs
+    // body(chunkBegin, chunkEnd) on the workers plus the calling thread. Nested calls
+    // from a worker run inline so a saturated pool cannot deadlock on itself.
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body, size_t minChunk = 1024);
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+    static bool isWorkerThread();
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+};
+
+ThreadPool& globalThreadPool();
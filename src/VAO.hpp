@@ -46,10 +46,20 @@ public:
         glBindVertexArray(0); 
     }
 
+    // Deletes the name now rather than at destruction; ID is 0 afterwards.
+    void release() {
+        if (ID != 0) {
+            glDeleteVertexArrays(1, &ID);
+            ID = 0;
+        }
+    }
+
+    // normalized maps integer attributes to [0, 1] / [-1, 1], as the packed vertex
+    // format needs; float attributes ignore it.
     void linkAttrib(const VBO& vbo, GLuint layout, GLint numComponents,
-        GLenum type, GLsizei stride, const void* offset) const {
+        GLenum type, GLsizei stride, const void* offset, GLboolean normalized = GL_FALSE) const {
         vbo.Bind();
-        glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
+        glVertexAttribPointer(layout, numComponents, type, normalized, stride, offset);
         glEnableVertexAttribArray(layout);
         vbo.UnBind();
     }
@@ -0,0 +1,170 @@
+// Offline pass over <model>.meshcache files: reorders every cached mesh with
+// MeshOptimizer and rewrites the cache in place, patching the stored BVH leaves to the
+// new triangle order so the editor's warm start keeps skipping the BLAS build. Cached
+// LOD chains follow the vertex renumbering; meshlets are rebuilt from the new order.
+//
+//     MeshCacheTool [--force] <model.gltf|model.glb>...
+//
+// The cache must exist and match its source; run the editor once to create it.
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "Meshlet.hpp"
+#include "ThreadPool.hpp"
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    struct OwnedMesh {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<LBVHNode> bvhNodes;
+        std::vector<uint32_t> lodIndices;
+        std::vector<MeshLOD> lods;
+        MeshletSet meshlets;
+        MeshCacheMesh record;
+        MeshOptimizationResult optimization;
+        bool lodsLost = false;
+    };
+
+    // Leaves occupy the last triangleCount slots of an LBVH node array.
+    void remapBVHLeaves(std::vector<LBVHNode>& nodes, const std::vector<uint32_t>& triangleRemap) {
+        if (nodes.empty() || nodes.size() != 2 * triangleRemap.size() - 1) {
+            nodes.clear();
+            return;
+        }
+        for (size_t i = triangleRemap.size() - 1; i < nodes.size(); ++i) {
+            nodes[i].primitiveIdx = triangleRemap[nodes[i].primitiveIdx];
+        }
+    }
+
+    // LOD levels index the same vertices, so they follow the fetch remap and get their
+    // own cache reorder. Levels referencing a dropped vertex invalidate the whole chain,
+    // reported by returning false.
+    bool remapLODs(OwnedMesh& mesh) {
+        const std::vector<uint32_t>& vertexRemap = mesh.optimization.vertexRemap;
+        for (uint32_t& index : mesh.lodIndices) {
+            if (index >= vertexRemap.size() || vertexRemap[index] == MeshOptimizer::kDroppedVertex) {
+                mesh.lodIndices.clear();
+                mesh.lods.clear();
+                return false;
+            }
+            index = vertexRemap[index];
+        }
+        for (const MeshLOD& lod : mesh.lods) {
+            std::vector<uint32_t> level(mesh.lodIndices.begin() + lod.firstIndex, mesh.lodIndices.begin() + lod.firstIndex + lod.indexCount);
+            std::vector<uint32_t> triangleOrder;
+            MeshOptimizer::optimizeVertexCache(level, mesh.vertices.size(), triangleOrder);
+            std::copy(level.begin(), level.end(), mesh.lodIndices.begin() + lod.firstIndex);
+        }
+        return true;
+    }
+
+    bool optimizeCache(const std::string& sourcePath, bool force) {
+        std::vector<OwnedMesh> meshes;
+        std::vector<MeshCacheTexture> textures;
+        std::vector<std::string> dependencies;
+        uint32_t flags = 0;
+        {
+            // The mapping must be released before the cache file is replaced.
+            MeshCache cache;
+            if (!cache.open(sourcePath)) {
+                MyglobalLogger().logMessage(Logger::ERROR, "No valid mesh cache for " + sourcePath, __FILE__, __LINE__);
+                return false;
+            }
+            if ((cache.getFlags() & MeshCache::kFlagOptimized) && !force) {
+                MyglobalLogger().logMessage(Logger::INFO, MeshCache::pathFor(sourcePath) + " is already optimized", __FILE__, __LINE__);
+                return true;
+            }
+
+            textures = cache.getTextures();
+            dependencies = cache.getDependencies();
+            flags = cache.getFlags();
+            meshes.resize(cache.getMeshes().size());
+            for (size_t i = 0; i < meshes.size(); ++i) {
+                const MeshCacheMesh& cached = cache.getMeshes()[i];
+                meshes[i].vertices.assign(cached.vertices.begin(), cached.vertices.end());
+                meshes[i].indices.assign(cached.indices.begin(), cached.indices.end());
+                meshes[i].bvhNodes.assign(cached.bvhNodes.begin(), cached.bvhNodes.end());
+                meshes[i].lodIndices.assign(cached.lodIndices.begin(), cached.lodIndices.end());
+                meshes[i].lods.assign(cached.lods.begin(), cached.lods.end());
+                meshes[i].meshlets.indices.assign(cached.meshletIndices.begin(), cached.meshletIndices.end());
+                meshes[i].meshlets.meshlets.assign(cached.meshlets.begin(), cached.meshlets.end());
+                meshes[i].record = cached;
+            }
+        }
+
+        globalThreadPool().parallelFor(0, meshes.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                OwnedMesh& mesh = meshes[i];
+                mesh.optimization = MeshOptimizer::optimizeMesh(mesh.vertices, mesh.indices);
+                if (mesh.optimization.optimized) {
+                    remapBVHLeaves(mesh.bvhNodes, mesh.optimization.triangleRemap);
+                    mesh.lodsLost = !remapLODs(mesh);
+                    if (!mesh.meshlets.meshlets.empty()) {
+                        mesh.meshlets = MeshletBuilder::build(mesh.vertices, mesh.indices);
+                    }
+                }
+            }
+        }, 1);
+
+        std::vector<MeshCacheMesh> records(meshes.size());
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            OwnedMesh& mesh = meshes[i];
+            if (mesh.optimization.optimized) {
+                MyglobalLogger().logMessage(Logger::INFO, "Mesh " + std::to_string(i) + ": " +
+                    MeshOptimizer::describe(mesh.optimization, mesh.indices.size() / 3), __FILE__, __LINE__);
+            }
+            else {
+                MyglobalLogger().logMessage(Logger::WARNING, "Mesh " + std::to_string(i) + " has an invalid index buffer, left unoptimized", __FILE__, __LINE__);
+            }
+
+            records[i] = mesh.record;
+            records[i].vertices = mesh.vertices;
+            records[i].indices = mesh.indices;
+            records[i].bvhNodes = mesh.bvhNodes;
+            records[i].lodIndices = mesh.lodIndices;
+            records[i].lods = mesh.lods;
+            records[i].meshletIndices = mesh.meshlets.indices;
+            records[i].meshlets = mesh.meshlets.meshlets;
+            records[i].bounds = AABB();
+            for (const Vertex& vertex : mesh.vertices) {
+                records[i].bounds.expand(vertex.position);
+            }
+        }
+
+        // A chain lost to a bad remap clears the flag so the editor regenerates it.
+        if (std::any_of(meshes.begin(), meshes.end(), [](const OwnedMesh& mesh) { return mesh.lodsLost; })) {
+            flags &= ~MeshCache::kFlagLODs;
+        }
+        return MeshCache::write(sourcePath, records, textures, flags | MeshCache::kFlagOptimized, dependencies);
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    bool force = false;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        }
+        else {
+            sources.emplace_back(argv[i]);
+        }
+    }
+
+    if (sources.empty()) {
+        std::cerr << "Usage: MeshCacheTool [--force] <model.gltf|model.glb>..." << std::endl;
+        return 2;
+    }
+
+    int failures = 0;
+    for (const std::string& source : sources) {
+        if (!optimizeCache(source, force)) {
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Offline import of images into <image>.ctex block-compressed caches, so the editor's
+// first run skips the CPU encode. Options must match the loader's for the cache to be
+// used: model textures load with the defaults (diffuse maps add --srgb) and the moon and star
+// maps with --format bc7 --no-flip. The cloud noise, weather and curl textures load uncompressed.
+// --volume imports width x width*width atlases as BC7 volumes.
+//
+//     TextureTool [--force] [--format auto|bc1|bc3|bc5|bc7] [--no-flip] [--no-mips] [--kaiser] [--srgb] [--volume] <image>...
+//
+// Without --force, caches that are current and built with the same options are kept.
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CompressedTexture.hpp"
+#include "../src/Logger/Logger.hpp"
+
+namespace {
+    bool parseFormat(const std::string& name, BlockFormat& format) {
+        if (name == "auto") format = BlockFormat::Auto;
+        else if (name == "bc1") format = BlockFormat::BC1;
+        else if (name == "bc3") format = BlockFormat::BC3;
+        else if (name == "bc5") format = BlockFormat::BC5;
+        else if (name == "bc7") format = BlockFormat::BC7;
+        else return false;
+        return true;
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    bool force = false;
+    CompressedTexture::ImportOptions options;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        }
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parseFormat(argv[++i], options.format)) {
+                std::cerr << "Unknown format " << argv[i] << std::endl;
+                return 2;
+            }
+        }
+        else if (std::strcmp(argv[i], "--no-flip") == 0) {
+            options.flipVertically = false;
+        }
+        else if (std::strcmp(argv[i], "--no-mips") == 0) {
+            options.mipmaps = false;
+        }
+        else if (std::strcmp(argv[i], "--kaiser") == 0) {
+            options.mipFilter = MipFilter::Kaiser;
+        }
+        else if (std::strcmp(argv[i], "--srgb") == 0) {
+            options.srgb = true;
+        }
+        else if (std::strcmp(argv[i], "--volume") == 0) {
+            options.volumeAtlas = true;
+        }
+        else {
+            sources.emplace_back(argv[i]);
+        }
+    }
+
+    if (sources.empty()) {
+        std::cerr << "Usage: TextureTool [--force] [--format auto|bc1|bc3|bc5|bc7] [--no-flip] [--no-mips] [--kaiser] [--srgb] [--volume] <image>..." << std::endl;
+        return 2;
+    }
+
+    int failures = 0;
+    for (const std::string& source : sources) {
+        CompressedTexture texture;
+        const bool imported = force ? CompressedTexture::import(source, options) : texture.openOrImport(source, options);
+        if (!imported) {
+            MyglobalLogger().logMessage(Logger::ERROR, "Could not import " + source, __FILE__, __LINE__);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}